@@ -0,0 +1,21 @@
+//21800637 Jooyoung Jang 
+//21600415 Sehyuk Yang
+// Target for `make check-limits`: allocates 256 MB as soon as it starts and
+// crashes when it cannot. A run that gets the memory was not limited in time,
+// and it leaves the file named by its argument behind as evidence.
+#include <stdio.h>
+#include <stdlib.h>
+#include "bench.h"
+
+int main(int argc, char ** argv)
+{
+    char * big = malloc(256 << 20);
+    if(big==NULL)
+        crash();
+    if(argc>1)
+        fclose(fopen(argv[1],"w"));
+    size_t len;
+    free(read_input(&len));
+    free(big);
+    return 0;
+}
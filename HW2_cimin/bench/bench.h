@@ -0,0 +1,48 @@
+//21800637 Jooyoung Jang 
+//21600415 Sehyuk Yang
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// What the benchmark targets print when they crash; run.sh passes it as -m
+#define CRASH_MSG "bench: crashed"
+
+// Reads all of stdin
+static inline char * read_input(size_t * len)
+{
+    size_t cap = 4096;
+    char * buf = malloc(cap);
+    *len = 0;
+    size_t n;
+    while(buf!=NULL && (n = fread(buf+*len,1,cap-*len,stdin))>0)
+    {
+        *len += n;
+        if(*len==cap)
+            buf = realloc(buf,cap *= 2);
+    }
+    if(buf==NULL)
+        exit(1);
+    return buf;
+}
+
+static inline int contains(const char * buf, size_t len, const char * s)
+{
+    size_t n = strlen(s);
+    for(size_t i=0;i+n<=len;i++)
+    {
+        if(memcmp(buf+i,s,n)==0)
+            return 1;
+    }
+    return 0;
+}
+
+static inline void crash(void)
+{
+    fprintf(stderr,"%s\n",CRASH_MSG);
+    abort();
+}
+
+#endif
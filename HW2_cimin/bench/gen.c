@@ -0,0 +1,70 @@
+//21800637 Jooyoung Jang 
+//21600415 Sehyuk Yang
+// Writes a crashing input for a benchmark target to stdout: size bytes of
+// pseudo-random text (the same for every run) with the crash trigger spread
+// through it.
+//
+//   ./gen substr|paren|hang size
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static unsigned long seed = 21800637;
+
+static int next_random(void)
+{
+    seed = seed*6364136223846793005UL + 1442695040888963407UL;
+    return seed >> 33;
+}
+
+// Puts s at offset at, or where it fits
+static void place(char * buf, size_t size, size_t at, const char * s)
+{
+    size_t n = strlen(s);
+    if(at+n>size)
+        at = size-n;
+    memcpy(buf+at,s,n);
+}
+
+int main(int argc, char * argv[])
+{
+    const char * junk = "abcdefghijklmnopqrstuvwxyz ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789 .,;:\n";
+    size_t size = argc>2 ? atoi(argv[2]) : 0;
+    if(argc<3 || size<16)
+    {
+        fprintf(stderr,"Usage: %s substr|paren|hang size (at least 16)\n",argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    char * buf = malloc(size);
+    for(size_t i=0;i<size;i++)
+        buf[i] = junk[next_random()%strlen(junk)];
+
+    if(strcmp(argv[1],"paren")==0)
+    {
+        // Four levels opened in the first half and closed in the second,
+        // with a few balanced pairs as decoys
+        for(int k=0;k<4;k++)
+        {
+            place(buf,size,size*(k+1)/10,"(");
+            place(buf,size,size*(9-k)/10,")");
+        }
+        for(int k=0;k<3;k++)
+            place(buf,size,size*(2*k+1)/7+1,"()");
+    }
+    else if(strcmp(argv[1],"hang")==0)
+    {
+        place(buf,size,size/5,"#");
+        place(buf,size,size*3/5,"BOOM");
+    }
+    else if(strcmp(argv[1],"substr")==0)
+        place(buf,size,size/2,"BOOM");
+    else
+    {
+        fprintf(stderr,"Unknown input kind %s\n",argv[1]);
+        return EXIT_FAILURE;
+    }
+    fwrite(buf,1,size,stdout);
+    free(buf);
+    return 0;
+}
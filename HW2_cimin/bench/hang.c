@@ -0,0 +1,22 @@
+//21800637 Jooyoung Jang 
+//21600415 Sehyuk Yang
+// Benchmark target that hangs on some inputs: it spins forever unless the
+// input contains a '#', and crashes when it also contains BOOM. Every
+// candidate that drops the '#' costs a full timeout.
+#include <stdio.h>
+#include <stdlib.h>
+#include "bench.h"
+
+int main(void)
+{
+    size_t len;
+    char * input = read_input(&len);
+    if(!contains(input,len,"#"))
+    {
+        for(volatile unsigned long spin=0;;spin++)
+            ;
+    }
+    if(contains(input,len,"BOOM"))
+        crash();
+    return 0;
+}
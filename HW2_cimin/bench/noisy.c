@@ -0,0 +1,19 @@
+//21800637 Jooyoung Jang 
+//21600415 Sehyuk Yang
+// Benchmark target that writes 256 KB of warnings to stderr for every input,
+// so the error message has to be found behind them; crashes when the input
+// contains BOOM
+#include <stdio.h>
+#include <stdlib.h>
+#include "bench.h"
+
+int main(void)
+{
+    size_t len;
+    char * input = read_input(&len);
+    for(int i=0;i<4096;i++)
+        fprintf(stderr,"warning: line %5d looks suspicious, going on anyway\n",i);
+    if(contains(input,len,"BOOM"))
+        crash();
+    return 0;
+}
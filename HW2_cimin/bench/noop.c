@@ -0,0 +1,8 @@
+//21800637 Jooyoung Jang 
+//21600415 Sehyuk Yang
+// Spawn benchmark target: does nothing. Linked statically, so exec has no
+// dynamic loading to do and the cost of starting the process shows.
+int main(void)
+{
+    return 0;
+}
@@ -0,0 +1,26 @@
+//21800637 Jooyoung Jang 
+//21600415 Sehyuk Yang
+// Benchmark target in the manner of the balance example: crashes when the
+// parentheses of the input are balanced and nest at least four deep. Other
+// bytes are ignored, so the minimal input is (((()))).
+#include <stdio.h>
+#include <stdlib.h>
+#include "bench.h"
+
+int main(void)
+{
+    size_t len;
+    char * input = read_input(&len);
+    int depth = 0;
+    int deepest = 0;
+    for(size_t i=0;i<len;i++)
+    {
+        if(input[i]=='(' && ++depth>deepest)
+            deepest = depth;
+        else if(input[i]==')' && --depth<0)
+            return 1;
+    }
+    if(depth==0 && deepest>=4)
+        crash();
+    return 0;
+}
@@ -0,0 +1,52 @@
+#!/bin/sh
+# Runs cimin on the synthetic benchmark targets for every strategy and -j and
+# prints executions, wall time and result size per run. Started by
+# `make bench` from the cimin directory; the environment picks the matrix:
+#
+#   STRATEGIES="ddmin window hier probdd"  JOBS="1 4"  SIZE=128  EXTRA="-x spawn"
+STRATEGIES=${STRATEGIES:-"ddmin window hier probdd"}
+JOBS=${JOBS:-"1 4"}
+SIZE=${SIZE:-128}
+TARGETS="substr paren slowstart noisy hang"
+MSG="bench: crashed"
+
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+
+# The input kind each target reads
+input_kind() {
+    case $1 in
+    paren|hang) echo "$1" ;;
+    *) echo substr ;;
+    esac
+}
+
+# Time limit in ms: short for the target that hangs, since every hang costs
+# that much, and generous for the others
+limit() {
+    case $1 in
+    hang) echo 50 ;;
+    *) echo 1000 ;;
+    esac
+}
+
+field() {
+    sed -n "s/.*\"$2\": \"*\([^\",]*\).*/\1/p" "$1"
+}
+
+printf "%-10s %-12s %4s %10s %9s %12s\n" target strategy jobs executions wall_s result
+for t in $TARGETS; do
+    ./bench/gen "$(input_kind "$t")" "$SIZE" > "$dir/$t.in" || exit 1
+    for s in $STRATEGIES; do
+        for j in $JOBS; do
+            if ! ./cimin -i "$dir/$t.in" -o "$dir/out" -m "$MSG" -s "$s" -j "$j" -t "$(limit "$t")" \
+                    --progress 0 --stats "$dir/stats.json" $EXTRA "./bench/$t" > "$dir/log" 2>&1; then
+                printf "%-10s %-12s %4s %10s\n" "$t" "$s" "$j" failed
+                continue
+            fi
+            printf "%-10s %-12s %4s %10s %9s %5s/%-6s\n" "$t" "$s" "$j" \
+                "$(field "$dir/stats.json" executions)" "$(field "$dir/stats.json" wall_seconds)" \
+                "$(field "$dir/stats.json" result_bytes)" "$(field "$dir/stats.json" original_bytes)"
+        done
+    done
+done
@@ -0,0 +1,18 @@
+//21800637 Jooyoung Jang 
+//21600415 Sehyuk Yang
+// Benchmark target with an expensive start-up, 20 ms before it even looks
+// at the input; crashes when the input contains BOOM
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "bench.h"
+
+int main(void)
+{
+    usleep(20000);
+    size_t len;
+    char * input = read_input(&len);
+    if(contains(input,len,"BOOM"))
+        crash();
+    return 0;
+}
@@ -0,0 +1,15 @@
+//21800637 Jooyoung Jang 
+//21600415 Sehyuk Yang
+// Benchmark target: crashes when the input contains BOOM
+#include <stdio.h>
+#include <stdlib.h>
+#include "bench.h"
+
+int main(void)
+{
+    size_t len;
+    char * input = read_input(&len);
+    if(contains(input,len,"BOOM"))
+        crash();
+    return 0;
+}
@@ -0,0 +1,169 @@
+//21800637 Jooyoung Jang 
+//21600415 Sehyuk Yang
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cimin.h"
+
+// Outcomes of candidates that were already run, keyed by a 128-bit hash of
+// their bytes and their length. Open addressing, grown at half load.
+struct cache_entry {
+    struct cache_key key;
+    int used;
+    int verdict;
+};
+
+static struct cache_entry * table = NULL;
+static size_t capacity = 0;
+static size_t count = 0;
+
+int cache_hits = 0;
+int cache_misses = 0;
+
+static uint64_t fmix64(uint64_t h)
+{
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+static uint64_t rotl(uint64_t x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+struct hash_state {
+    uint64_t a;
+    uint64_t b;
+    unsigned char pending[8];
+    int npending;
+};
+
+static void mix_word(struct hash_state * h, const unsigned char * p)
+{
+    uint64_t w;
+    memcpy(&w,p,8);
+    h->a = rotl((h->a ^ w) * 0x87c37b91114253d5ULL,31) * 0x4cf5ad432745937fULL;
+    h->b = rotl((h->b + w) * 0x9e3779b97f4a7c15ULL,27) ^ h->a;
+}
+
+// Two 64-bit lanes fed eight bytes at a time and finished with the
+// MurmurHash3 mixer. Bytes left over at the end of a span are carried into the
+// next one, so the key only depends on the candidate's contents and not on
+// how they are split into spans.
+struct cache_key cache_hash(const struct candidate * c)
+{
+    struct hash_state h = { 0xcbf29ce484222325ULL, 0x9e3779b97f4a7c15ULL, { 0 }, 0 };
+
+    for(int i=0;i<c->count;i++)
+    {
+        const unsigned char * data = (const unsigned char *)original.data+c->spans[i].off;
+        size_t len = c->spans[i].len;
+        while(len>0 && h.npending>0)
+        {
+            h.pending[h.npending++] = *data++;
+            len--;
+            if(h.npending==8)
+            {
+                mix_word(&h,h.pending);
+                h.npending = 0;
+            }
+        }
+        if(len==0)
+            continue;
+        for(;len>=8;data+=8,len-=8)
+            mix_word(&h,data);
+        memcpy(h.pending,data,len);
+        h.npending = len;
+    }
+    memset(h.pending+h.npending,0,8-h.npending);
+    mix_word(&h,h.pending);
+
+    struct cache_key key;
+    key.h1 = fmix64(h.a ^ c->len);
+    key.h2 = fmix64(h.b + c->len);
+    key.len = c->len;
+    return key;
+}
+
+static struct cache_entry * find(struct cache_entry * t, size_t cap, struct cache_key * key)
+{
+    size_t i = key->h1 & (cap - 1);
+    while(t[i].used && (t[i].key.h1!=key->h1 || t[i].key.h2!=key->h2 || t[i].key.len!=key->len))
+        i = (i + 1) & (cap - 1);
+    return &t[i];
+}
+
+// Returns the recorded verdict for key, or -1 when the candidate is new
+int cache_lookup(struct cache_key * key)
+{
+    if(capacity>0)
+    {
+        struct cache_entry * e = find(table,capacity,key);
+        if(e->used)
+        {
+            cache_hits++;
+            return e->verdict;
+        }
+    }
+    cache_misses++;
+    return -1;
+}
+
+void cache_insert(struct cache_key * key, int verdict)
+{
+    if(2*(count+1)>capacity)
+    {
+        size_t new_capacity = capacity ? 2*capacity : 1024;
+        struct cache_entry * t = calloc(new_capacity,sizeof(struct cache_entry));
+        if(t==NULL)
+            error_handler("Growing the candidate cache");
+        for(size_t i=0;i<capacity;i++)
+        {
+            if(table[i].used)
+                *find(t,new_capacity,&table[i].key) = table[i];
+        }
+        free(table);
+        table = t;
+        capacity = new_capacity;
+    }
+
+    struct cache_entry * e = find(table,capacity,key);
+    if(!e->used)
+        count++;
+    e->key = *key;
+    e->used = 1;
+    e->verdict = verdict;
+}
+
+// Writes the entry count and then every entry, for checkpoints
+int cache_save(FILE * fp)
+{
+    if(fwrite(&count,sizeof(count),1,fp)!=1)
+        return -1;
+    for(size_t i=0;i<capacity;i++)
+    {
+        if(table[i].used && fwrite(&table[i],sizeof(table[i]),1,fp)!=1)
+            return -1;
+    }
+    return 0;
+}
+
+// Adds the entries cache_save() wrote to the cache
+int cache_load(FILE * fp)
+{
+    size_t n;
+    struct cache_entry e;
+    if(fread(&n,sizeof(n),1,fp)!=1)
+        return -1;
+    for(size_t i=0;i<n;i++)
+    {
+        if(fread(&e,sizeof(e),1,fp)!=1)
+            return -1;
+        cache_insert(&e.key,e.verdict);
+    }
+    return 0;
+}
@@ -0,0 +1,176 @@
+//21800637 Jooyoung Jang 
+//21600415 Sehyuk Yang
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <sys/uio.h>
+#include "cimin.h"
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+// Candidates never hold bytes of their own: they are lists of spans over the
+// original input, which stays mapped and untouched for the whole run.
+
+void cand_reserve(struct candidate * c, int count)
+{
+    if(count<=c->capacity)
+        return;
+    int capacity = c->capacity ? c->capacity : 16;
+    while(capacity<count)
+        capacity *= 2;
+    c->spans = realloc(c->spans,capacity*sizeof(struct span));
+    if(c->spans==NULL)
+        error_handler("Growing a candidate");
+    c->capacity = capacity;
+}
+
+// Appends original[off..off+len), merging it into the last span if adjacent
+static void push(struct candidate * c, size_t off, size_t len)
+{
+    if(len==0)
+        return;
+    c->len += len;
+    if(c->count>0 && c->spans[c->count-1].off+c->spans[c->count-1].len==off)
+    {
+        c->spans[c->count-1].len += len;
+        return;
+    }
+    cand_reserve(c,c->count+1);
+    c->spans[c->count].off = off;
+    c->spans[c->count].len = len;
+    c->count++;
+}
+
+void cand_whole(struct candidate * out)
+{
+    out->count = 0;
+    out->len = 0;
+    push(out,0,original.len);
+}
+
+void cand_copy(const struct candidate * from, struct candidate * out)
+{
+    out->count = 0;
+    out->len = 0;
+    for(int i=0;i<from->count;i++)
+        push(out,from->spans[i].off,from->spans[i].len);
+}
+
+// out = bytes [start, end) of from
+void cand_slice(const struct candidate * from, size_t start, size_t end, struct candidate * out)
+{
+    size_t pos = 0;
+    out->count = 0;
+    out->len = 0;
+    for(int i=0;i<from->count && pos<end;i++)
+    {
+        const struct span * sp = &from->spans[i];
+        size_t lo = pos > start ? pos : start;
+        size_t hi = pos+sp->len < end ? pos+sp->len : end;
+        if(lo<hi)
+            push(out,sp->off+(lo-pos),hi-lo);
+        pos += sp->len;
+    }
+}
+
+// out = from without bytes [start, end)
+void cand_cut(const struct candidate * from, size_t start, size_t end, struct candidate * out)
+{
+    size_t pos = 0;
+    out->count = 0;
+    out->len = 0;
+    for(int i=0;i<from->count;i++)
+    {
+        const struct span * sp = &from->spans[i];
+        size_t sp_end = pos+sp->len;
+        if(pos<start)
+            push(out,sp->off,(sp_end < start ? sp_end : start)-pos);
+        if(sp_end>end)
+        {
+            size_t lo = pos > end ? pos : end;
+            push(out,sp->off+(lo-pos),sp_end-lo);
+        }
+        pos = sp_end;
+    }
+}
+
+// out = from without the given ranges, which are sorted and do not overlap
+void cand_cut_many(const struct candidate * from, const struct span * cuts, int n, struct candidate * out)
+{
+    size_t pos = 0;
+    int k = 0;
+    out->count = 0;
+    out->len = 0;
+    for(int i=0;i<from->count;i++)
+    {
+        const struct span * sp = &from->spans[i];
+        size_t at = pos;
+        size_t sp_end = pos+sp->len;
+        while(at<sp_end)
+        {
+            while(k<n && cuts[k].off+cuts[k].len<=at)
+                k++;
+            if(k<n && cuts[k].off<=at)
+            {
+                at = cuts[k].off+cuts[k].len;
+                continue;
+            }
+            size_t stop = k<n && cuts[k].off<sp_end ? cuts[k].off : sp_end;
+            push(out,sp->off+(at-pos),stop-at);
+            at = stop;
+        }
+        pos = sp_end;
+    }
+}
+
+// Writes the candidate from the cursor (span index, offset in that span) on
+// with writev and advances the cursor. Returns what writev returned.
+ssize_t cand_write(int fd, const struct candidate * c, int * span, size_t * off)
+{
+    struct iovec iov[IOV_MAX];
+    int n = 0;
+    for(int i=*span;i<c->count && n<IOV_MAX;i++,n++)
+    {
+        size_t skip = i==*span ? *off : 0;
+        iov[n].iov_base = original.data+c->spans[i].off+skip;
+        iov[n].iov_len = c->spans[i].len-skip;
+    }
+
+    ssize_t written = writev(fd,iov,n);
+    if(written<=0)
+        return written;
+
+    size_t left = written;
+    while(left>0)
+    {
+        size_t rest = c->spans[*span].len-*off;
+        if(left<rest)
+        {
+            *off += left;
+            break;
+        }
+        left -= rest;
+        (*span)++;
+        *off = 0;
+    }
+    return written;
+}
+
+void cand_fwrite(const struct candidate * c, FILE * fp)
+{
+    for(int i=0;i<c->count;i++)
+        fwrite(original.data+c->spans[i].off,1,c->spans[i].len,fp);
+}
+
+// Copies the candidate's bytes into buf, which holds at least c->len bytes
+void cand_flatten(const struct candidate * c, char * buf)
+{
+    for(int i=0;i<c->count;i++)
+    {
+        memcpy(buf,original.data+c->spans[i].off,c->spans[i].len);
+        buf += c->spans[i].len;
+    }
+}
@@ -0,0 +1,166 @@
+//21800637 Jooyoung Jang 
+//21600415 Sehyuk Yang
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "cimin.h"
+
+// Checkpoints let a long reduction survive a restart. Every
+// CHECKPOINT_SECONDS, at the start of a round, and on Ctrl-C the current
+// best input (as spans of the original), the strategy's position (level,
+// hdd depth and operation, ddmin granularity or window size), the counters,
+// the original's stack hash and the whole candidate cache are written to
+// checkpoint_file; a new file replaces the old one by rename, so a crash
+// half way leaves the last one intact. Nothing is written before the
+// baseline run has passed, since a checkpoint vouches for its input crashing.
+// --resume starts from that state instead of the original input.
+
+#define CHECKPOINT_SECONDS 30
+#define CHECKPOINT_MAGIC "CIMINCK2"
+
+struct checkpoint_header {
+    char magic[8];
+    struct cache_key input;     // hash of the original input
+    char strategy[64];          // -s as given
+    uint64_t oracle;            // oracle_id() of the run
+    uint64_t stack_reference;
+    struct progress progress;
+    int timeout_ms;
+    int exec_count;
+    int cancel_count;
+    int timeout_count;
+    int cache_hits;
+    int cache_misses;
+    int spans;
+};
+
+char * checkpoint_file = NULL;
+struct progress progress;
+int resuming = 0;
+int baseline_passed = 0;
+
+static struct cache_key input_key;
+static long last_save = -1;
+
+static long now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return ts.tv_sec;
+}
+
+static struct cache_key original_key(void)
+{
+    if(input_key.len!=original.len)
+    {
+        struct candidate c = { 0 };
+        cand_whole(&c);
+        input_key = cache_hash(&c);
+        free(c.spans);
+    }
+    return input_key;
+}
+
+// Writes a checkpoint if the last one is CHECKPOINT_SECONDS old, or always
+// when force is set
+void checkpoint(int force)
+{
+    if(checkpoint_file==NULL || !baseline_passed)
+        return;
+    if(last_save==-1)
+        last_save = now_s();
+    if(!force && now_s()-last_save<CHECKPOINT_SECONDS)
+        return;
+
+    struct checkpoint_header h;
+    memset(&h,0,sizeof(h));
+    memcpy(h.magic,CHECKPOINT_MAGIC,sizeof(h.magic));
+    h.input = original_key();
+    strncpy(h.strategy,strategy_name,sizeof(h.strategy)-1);
+    h.oracle = oracle_id();
+    h.stack_reference = stack_reference;
+    h.progress = progress;
+    h.timeout_ms = timeout_ms;
+    h.exec_count = exec_count;
+    h.cancel_count = cancel_count;
+    h.timeout_count = timeout_count;
+    h.cache_hits = cache_hits;
+    h.cache_misses = cache_misses;
+    h.spans = reduced_result.count;
+
+    char tmp[BUFSIZE];
+    snprintf(tmp,sizeof(tmp),"%s.tmp",checkpoint_file);
+    FILE * fp = fopen(tmp,"w");
+    if(fp==NULL)
+        error_handler("Writing a checkpoint");
+    if(fwrite(&h,sizeof(h),1,fp)!=1
+       || fwrite(reduced_result.spans,sizeof(struct span),h.spans,fp)!=(size_t)h.spans
+       || cache_save(fp)==-1 || fclose(fp)==EOF)
+        error_handler("Writing a checkpoint");
+    if(rename(tmp,checkpoint_file)==-1)
+        error_handler("Writing a checkpoint");
+    last_save = now_s();
+}
+
+// Restores the state of checkpoint_file and sets resuming, so that the
+// strategy picks up its position in progress
+void load_checkpoint(void)
+{
+    struct checkpoint_header h;
+    FILE * fp = fopen(checkpoint_file,"r");
+    if(fp==NULL)
+        error_handler("Opening the checkpoint");
+    if(fread(&h,sizeof(h),1,fp)!=1 || memcmp(h.magic,CHECKPOINT_MAGIC,sizeof(h.magic))!=0)
+        error_handler("Not a cimin checkpoint");
+
+    struct cache_key key = original_key();
+    if(memcmp(&h.input,&key,sizeof(key))!=0)
+        error_handler("The checkpoint is for a different input");
+    if(strncmp(h.strategy,strategy_name,sizeof(h.strategy))!=0)
+        error_handler("The checkpoint is for a different strategy");
+    if(h.oracle!=oracle_id())
+        error_handler("The checkpoint is for a different -m, --signal, --exit or --stack");
+    if(h.spans<0)
+        error_handler("Corrupt checkpoint");
+
+    struct candidate c = { 0 };
+    cand_reserve(&c,h.spans);
+    if(fread(c.spans,sizeof(struct span),h.spans,fp)!=(size_t)h.spans)
+        error_handler("Truncated checkpoint");
+    c.count = h.spans;
+    for(int i=0;i<c.count;i++)
+    {
+        if(c.spans[i].off>original.len || c.spans[i].len>original.len-c.spans[i].off)
+            error_handler("Corrupt checkpoint");
+        c.len += c.spans[i].len;
+    }
+    if(cache_load(fp)==-1)
+        error_handler("Truncated checkpoint");
+    fclose(fp);
+
+    cand_copy(&c,&reduced_result);
+    free(c.spans);
+    progress = h.progress;
+    stack_reference = h.stack_reference;
+    if(timeout_factor>0)
+        timeout_ms = h.timeout_ms;
+    exec_count = h.exec_count;
+    cancel_count = h.cancel_count;
+    timeout_count = h.timeout_count;
+    cache_hits = h.cache_hits;
+    cache_misses = h.cache_misses;
+    resuming = 1;
+    baseline_passed = 1;
+}
+
+// The granularity or window size a search starts with: the checkpointed
+// one for the first search after --resume, fresh otherwise or if the
+// checkpoint was written before any search began
+size_t resume_n(size_t fresh)
+{
+    if(!resuming)
+        return fresh;
+    resuming = 0;
+    return progress.n>0 ? progress.n : fresh;
+}
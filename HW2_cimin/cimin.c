@@ -1,7 +1,9 @@
 //21800637 Jooyoung Jang 
 //21600415 Sehyuk Yang
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <unistd.h>
+#include <getopt.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/time.h>
@@ -9,61 +11,294 @@
 #include <signal.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include "cimin.h"
 
-#define BUFSIZE 4096
+enum { DDMIN, WINDOW, HIER, HDD, PROBDD };
+// Long options; batch mode passes on the resource limits and the oracles
+enum { OPT_CHECKPOINT = 256, OPT_RESUME, OPT_PROGRESS, OPT_STATS, OPT_LISTEN, OPT_WORKER, OPT_MEM, OPT_CPU, OPT_FSIZE,
+       OPT_SIGNAL, OPT_EXIT, OPT_STACK };
+#define MAX_LEVELS 8
 
 char* input_file = NULL;
 char* output_file = NULL;
+char* input_dir = NULL;
+char* output_dir = NULL;
 char* error_msg = NULL;
 char* target_program = NULL;
-char * reduced_crash = NULL;
+struct buffer original;
 
 char ** additional_args;
 
-char * reduced_result=NULL;
-FILE * out_fp;
-pid_t child_pid;
-
+int strategy = DDMIN;
+char * strategy_name = "ddmin";
+// -s hier: the tokenizers of the levels, coarsest first
+const struct tokenizer * levels[MAX_LEVELS];
+int nlevels = 0;
+int jobs = 1;
+int exec_mode = EXEC_FORK;
+int exec_count = 0;
+int cancel_count = 0;
 
+// Per-candidate time limit in ms, 0 for none. With -t auto it is the
+// baseline run time of the original input times timeout_factor.
+int timeout_ms = 3000;
+int timeout_count = 0;
+double timeout_factor = 0;
+#define AUTO_BASELINE_LIMIT 60000
+#define AUTO_MIN_TIMEOUT 100
 
-int in_pipe[2];
-int e_pipe[2];
+// Smallest input known to reproduce the crash so far
+struct candidate reduced_result;
+FILE * out_fp;
 
 void int_handler(int sig);
-void alrm_handler(int sig);
-void error_handler(char * str);
-char* reduce(char* t);
-char * run_program(char * candidate);
+void run_baseline(void);
+void reduce_window(void);
+void reduce_ddmin(const struct tokenizer * tok);
+void parse_levels(char * list);
+int positive_option(const char * name, char * arg);
 
+#define USAGE "Usage: %s {-i input_file -o output_file | -I input_dir -O output_dir} [-m error_msg] [--signal sig|any] [--exit code] [--stack frames] [-s ddmin|window|hier[:levels]|hdd|probdd[:level]] [-j jobs] [-x fork|spawn|forksrv|persist] [-t ms|auto[:K]] [--checkpoint file] [--resume] [--progress seconds] [--stats file] [--mem MB] [--cpu seconds] [--fsize MB] [--listen addr] target [args]\n" \
+              "       %s --worker addr [-x fork|spawn|forksrv|persist] [--mem MB] [--cpu seconds] [--fsize MB] target [args]\n"
+
+static const struct option long_options[] = {
+    { "checkpoint", required_argument, NULL, OPT_CHECKPOINT },
+    { "resume", no_argument, NULL, OPT_RESUME },
+    { "progress", required_argument, NULL, OPT_PROGRESS },
+    { "stats", required_argument, NULL, OPT_STATS },
+    { "listen", required_argument, NULL, OPT_LISTEN },
+    { "worker", required_argument, NULL, OPT_WORKER },
+    { "mem", required_argument, NULL, OPT_MEM },
+    { "cpu", required_argument, NULL, OPT_CPU },
+    { "fsize", required_argument, NULL, OPT_FSIZE },
+    { "signal", required_argument, NULL, OPT_SIGNAL },
+    { "exit", required_argument, NULL, OPT_EXIT },
+    { "stack", required_argument, NULL, OPT_STACK },
+    { NULL, 0, NULL, 0 }
+};
 
 int main(int argc, char* argv[])
 {
     int opt;
-    while ((opt = getopt(argc, argv, "i:m:o:")) != -1)
+    // Everything but the input and output, for the processes of batch mode
+    char ** options = calloc(2*argc+1,sizeof(char *));
+    int noptions = 0;
+    int resume = 0;
+    char * stats_file = NULL;
+    char * worker_addr = NULL;
+    int jobs_given = 0;
+    // Progress lines by default only when someone watches
+    if (isatty(STDERR_FILENO))
+        progress_seconds = 5;
+    int longindex;
+    while ((opt = getopt_long(argc, argv, "+i:m:o:s:j:x:t:I:O:", long_options, &longindex)) != -1)
     {
+        if (opt < OPT_CHECKPOINT && strchr("ioIO", opt) == NULL && opt != '?')
+        {
+            asprintf(&options[noptions++], "-%c", opt);
+            options[noptions++] = optarg;
+        }
+        else if (opt >= OPT_MEM)
+        {
+            asprintf(&options[noptions++], "--%s", long_options[longindex].name);
+            options[noptions++] = optarg;
+        }
         switch (opt)
         {
         case 'i':
             input_file = optarg;
             break;
         case 'm':
+            // The matcher never reports an empty message as seen
+            if (optarg[0] == '\0')
+            {
+                fprintf(stderr, "-m needs a non-empty error message\n");
+                exit(EXIT_FAILURE);
+            }
             error_msg = optarg;
             break;
         case 'o':
             output_file = optarg;
             break;
+        case 'I':
+            input_dir = optarg;
+            break;
+        case 'O':
+            output_dir = optarg;
+            break;
+        case 's':
+            strategy_name = optarg;
+            if (strcmp(optarg, "ddmin") == 0)
+                strategy = DDMIN;
+            else if (strcmp(optarg, "window") == 0)
+                strategy = WINDOW;
+            else if (strncmp(optarg, "hier", 4) == 0 && (optarg[4] == '\0' || optarg[4] == ':'))
+            {
+                strategy = HIER;
+                parse_levels(optarg[4] == ':' ? optarg + 5 : "line,token,byte");
+            }
+            else if (strcmp(optarg, "hdd") == 0)
+                strategy = HDD;
+            else if (strncmp(optarg, "probdd", 6) == 0 && (optarg[6] == '\0' || optarg[6] == ':'))
+            {
+                strategy = PROBDD;
+                parse_levels(optarg[6] == ':' ? optarg + 7 : "byte");
+                if (nlevels != 1)
+                {
+                    fprintf(stderr, "-s probdd: takes one level\n");
+                    exit(EXIT_FAILURE);
+                }
+            }
+            else
+            {
+                fprintf(stderr, "Unknown strategy %s (ddmin, window, hier, hdd, probdd)\n", optarg);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'j':
+            jobs_given = 1;
+            jobs = atoi(optarg);
+            if (jobs < 1 || jobs > MAX_JOBS)
+            {
+                fprintf(stderr, "-j needs a value between 1 and %d\n", MAX_JOBS);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'x':
+            if (strcmp(optarg, "fork") == 0)
+                exec_mode = EXEC_FORK;
+            else if (strcmp(optarg, "spawn") == 0)
+                exec_mode = EXEC_SPAWN;
+            else if (strcmp(optarg, "forksrv") == 0)
+                exec_mode = EXEC_FORKSRV;
+            else if (strcmp(optarg, "persist") == 0)
+                exec_mode = EXEC_PERSIST;
+            else
+            {
+                fprintf(stderr, "Unknown execution mode %s (fork, spawn, forksrv, persist)\n", optarg);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 't':
+            if (strncmp(optarg, "auto", 4) == 0)
+            {
+                timeout_factor = optarg[4] == ':' ? atof(optarg + 5) : 10;
+                if (timeout_factor <= 0 || (optarg[4] != '\0' && optarg[4] != ':'))
+                {
+                    fprintf(stderr, "-t auto:K needs a positive factor K\n");
+                    exit(EXIT_FAILURE);
+                }
+            }
+            else if ((timeout_ms = atoi(optarg)) < 0)
+            {
+                fprintf(stderr, "-t needs a time in ms (0 for none) or auto[:K]\n");
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case OPT_CHECKPOINT:
+            checkpoint_file = optarg;
+            break;
+        case OPT_RESUME:
+            resume = 1;
+            break;
+        case OPT_PROGRESS:
+            progress_seconds = atoi(optarg);
+            break;
+        case OPT_STATS:
+            stats_file = optarg;
+            break;
+        case OPT_LISTEN:
+            remote_addr = optarg;
+            break;
+        case OPT_WORKER:
+            worker_addr = optarg;
+            break;
+        case OPT_MEM:
+            limit_mem_mb = positive_option("--mem", optarg);
+            break;
+        case OPT_CPU:
+            limit_cpu_s = positive_option("--cpu", optarg);
+            break;
+        case OPT_FSIZE:
+            limit_fsize_mb = positive_option("--fsize", optarg);
+            break;
+        case OPT_SIGNAL:
+            if ((oracle_signal = parse_signal(optarg)) == 0)
+            {
+                fprintf(stderr, "Unknown signal %s (a number, a name such as SEGV, or any)\n", optarg);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case OPT_EXIT:
+            oracle_exit = atoi(optarg);
+            if (oracle_exit < 0 || oracle_exit > 255)
+            {
+                fprintf(stderr, "--exit needs a code between 0 and 255\n");
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case OPT_STACK:
+            stack_frames = positive_option("--stack", optarg);
+            break;
         default:
-            fprintf(stderr, "Usage: %s -i input_file -m error_msg -o output_file\n", argv[0]);
+            fprintf(stderr, USAGE, argv[0], argv[0]);
             exit(EXIT_FAILURE);
         }
-        if (input_file != NULL && error_msg != NULL && output_file != NULL)
-            break;
     }
-    signal(SIGINT,int_handler);
-    signal(SIGALRM,alrm_handler);
+    // A worker takes its oracles from the coordinator
+    if (worker_addr != NULL)
+    {
+        if (optind >= argc)
+        {
+            fprintf(stderr, USAGE, argv[0], argv[0]);
+            exit(EXIT_FAILURE);
+        }
+        additional_args = &argv[optind];
+        target_program = additional_args[0];
+        signal(SIGPIPE,SIG_IGN);
+        run_worker(worker_addr);
+        return 0;
+    }
+    int batch = input_dir != NULL && output_dir != NULL && input_file == NULL && output_file == NULL;
+    if (!batch && (input_file == NULL || output_file == NULL || input_dir != NULL || output_dir != NULL))
+    {
+        fprintf(stderr, USAGE, argv[0], argv[0]);
+        exit(EXIT_FAILURE);
+    }
+    // Some oracle has to say what the crash is
+    // and, but for a coordinator, what to run
+    if ((error_msg == NULL && oracle_signal == 0 && oracle_exit == -1 && stack_frames == 0)
+        || (optind >= argc && remote_addr == NULL))
+    {
+        fprintf(stderr, USAGE, argv[0], argv[0]);
+        exit(EXIT_FAILURE);
+    }
+    if (remote_addr != NULL)
+    {
+        if (batch)
+        {
+            fprintf(stderr, "--listen works on one input (-i and -o)\n");
+            exit(EXIT_FAILURE);
+        }
+        // The workers run the targets, as many as connect unless -j says less
+        exec_mode = EXEC_REMOTE;
+        if (!jobs_given)
+            jobs = MAX_JOBS;
+    }
 
     additional_args = &argv[optind];
     target_program = additional_args[0];
+    if (batch)
+    {
+        run_corpus(input_dir, output_dir, options);
+        return 0;
+    }
+    if (checkpoint_file == NULL)
+        asprintf(&checkpoint_file, "%s.ckpt", output_file);
+    signal(SIGINT,int_handler);
+    signal(SIGPIPE,SIG_IGN);
 
    #ifdef DEBUG
     printf("input_file: %s\n", input_file);
@@ -71,218 +306,331 @@ int main(int argc, char* argv[])
     printf("output_file: %s\n", output_file);
     printf("target program : %s\n", target_program);
    #endif
-   FILE *fp;
-   if((fp = fopen(input_file, "r"))==NULL)
-    error_handler("fopen");
-    
+    int in_fd;
+    struct stat st;
+    if((in_fd = open(input_file, O_RDONLY))==-1 || fstat(in_fd,&st)==-1)
+        error_handler("Opening initial input");
+    if(st.st_size==0)
+        error_handler("Initial input is empty");
+
     if((out_fp = fopen(output_file, "w"))==NULL)
-    error_handler("fopen W");
+        error_handler("fopen W");
 
-   char init_crash[BUFSIZE];
+    // The original input stays mapped read-only for the whole run
+    original.len = st.st_size;
+    original.data = mmap(NULL,original.len,PROT_READ,MAP_PRIVATE,in_fd,0);
+    if(original.data==MAP_FAILED)
+        error_handler("Mapping initial input");
+    close(in_fd);
+    cand_whole(&reduced_result);
 
-   if(fread(init_crash,1,BUFSIZE,fp)==-1)
-        error_handler("Reading initial input");
+    struct timeval start, end;
+    gettimeofday(&start,NULL);
+    stats_begin();
+    // A checkpointed input is known to crash, so it needs no baseline run
+    if(resume)
+        load_checkpoint();
+    else
+        run_baseline();
+    if(strategy == WINDOW)
+        reduce_window();
+    else if(strategy == PROBDD)
+        reduce_probdd(levels[0]);
+    else if(strategy == HIER)
+    {
+        for(int i=resuming ? progress.step : 0;i<nlevels;i++)
+        {
+            progress.step = i;
+            reduce_ddmin(levels[i]);
+        }
+    }
+    else
+    {
+        if(strategy == HDD && !(resuming && progress.step == 1))
+        {
+            progress.step = 0;
+            reduce_hdd(&reduced_result);
+        }
+        progress.step = strategy == HDD;
+        reduce_ddmin(find_tokenizer("byte"));
+    }
+    gettimeofday(&end,NULL);
+
+    if(reduced_result.len<=BUFSIZE)
+    {
+        printf("Result: ");
+        cand_fwrite(&reduced_result,stdout);
+        printf("\n");
+    }
+    double wall = (end.tv_sec-start.tv_sec)+(end.tv_usec-start.tv_usec)/1e6;
+    printf("Result size: %zu of %zu bytes\n",reduced_result.len,original.len);
+    printf("Executions: %d (%d cancelled), wall time: %.3f s\n",exec_count,cancel_count,wall);
+    printf("Timeouts: %d (limit %d ms)\n",timeout_count,timeout_ms);
+    if(limit_mem_mb>0 || limit_cpu_s>0 || limit_fsize_mb>0)
+        printf("Resource limits: %d targets stopped by --cpu or --fsize\n",limit_count);
+    printf("Cache: %d hits, %d misses\n",cache_hits,cache_misses);
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF,&usage);
+    double cpu = usage.ru_utime.tv_sec+usage.ru_stime.tv_sec+(usage.ru_utime.tv_usec+usage.ru_stime.tv_usec)/1e6;
+    int candidates = cache_hits+cache_misses;
+    printf("cimin CPU: %.3f s, %.1f us per candidate\n",cpu,candidates ? cpu*1e6/candidates : 0);
+    if(target_runs>0)
+        printf("Target: %.1f ms per run\n",(double)target_ms/target_runs);
+    if(stats_file!=NULL)
+        write_stats(stats_file,input_file,output_file,wall,cpu);
 
-    reduced_crash = reduce(init_crash);
-    
-    printf("Result: %s\n",reduced_crash);
-    fwrite(reduced_crash,1,strlen(reduced_crash),out_fp);
+    cand_fwrite(&reduced_result,out_fp);
     fclose(out_fp);
-    
+    unlink(checkpoint_file);
+
     return 0;
 
 }
 
+// The only candidate of the baseline batch: the original input
+void make_original(int i, void * ctx, struct candidate * out)
+{
+    cand_whole(out);
+}
 
-char * reduce(char * t)
+// Runs the original input once to check that it reproduces the crash. With
+// -t auto its run time, times timeout_factor, becomes the per-candidate limit.
+void run_baseline(void)
 {
-    char * tm = t;
-    int s = strlen(tm) - 1;
-    
-    while(s>0)
+    struct timeval start, end;
+    if(timeout_factor>0)
+        timeout_ms = AUTO_BASELINE_LIMIT;
+
+    gettimeofday(&start,NULL);
+    int hit = run_batch(1,make_original,NULL);
+    gettimeofday(&end,NULL);
+    if(hit==-1)
+        error_handler(timeout_count>0 ? "Initial input timed out" : "Initial input does not reproduce the crash");
+    baseline_passed = 1;
+
+    if(timeout_factor>0)
     {
-        for(int i=0;i<strlen(tm)-s;i++)
-        {
-            if(pipe(in_pipe)==-1)
-            {
-                error_handler("Inpipe open");
-            }
-            if(pipe(e_pipe)==-1)
-            {
-                error_handler("Error pipe open");
-            }
-            char* head;
-            char* tail;
+        double ms = (end.tv_sec-start.tv_sec)*1e3+(end.tv_usec-start.tv_usec)/1e3;
+        timeout_ms = ms*timeout_factor;
+        if(timeout_ms<AUTO_MIN_TIMEOUT)
+            timeout_ms = AUTO_MIN_TIMEOUT;
+        #ifdef DEBUG
+        printf("Baseline: %.1f ms, timeout: %d ms\n",ms,timeout_ms);
+        #endif
+    }
+}
 
-           head = strndup(tm,i);
-           tail = strndup(&tm[i+s],strlen(tm)-1);
+struct window_ctx {
+    struct candidate * t;
+    size_t s;
+};
 
-           char * candidate = malloc(strlen(head)+strlen(tail)+1);
+// Candidate i of a window batch: t without t[i..i+s)
+void make_deletion(int i, void * ctx, struct candidate * out)
+{
+    struct window_ctx * w = ctx;
+    cand_cut(w->t,i,i+w->s,out);
+}
 
-           strcpy(candidate,head);
-           strcat(candidate,tail);
-           reduced_result = candidate;
-           free(head);
-           free(tail);
-           child_pid = fork();
+// Candidate i of a window batch: only t[i..i+s)
+void make_window(int i, void * ctx, struct candidate * out)
+{
+    struct window_ctx * w = ctx;
+    cand_slice(w->t,i,i+w->s,out);
+}
 
-           if(child_pid==0)// error return , receive input
-           {
-            if(dup2(in_pipe[0],STDIN_FILENO) == -1)
-            {
-                error_handler("Redirecting pipe for STDIN");
-            }
-            if(dup2(e_pipe[1],STDERR_FILENO) == -1)
-            {
-                error_handler("Redirecting pipe for STDERR");
-            }
-            #ifdef DEBUG
-            printf("Candidate: %s\n",candidate);
-            #endif
-                if(write(in_pipe[1],candidate,strlen(candidate))==-1)
-                {
-                    error_handler("Writing Thru PIPE_IN");
+// Candidate i of a window round: the deletions first, then the windows
+void make_window_round(int i, void * ctx, struct candidate * out)
+{
+    struct window_ctx * w = ctx;
+    int count = w->t->len - w->s;
+    if(i<count)
+        make_deletion(i,ctx,out);
+    else
+        make_window(i-count,ctx,out);
+}
 
-                }
-            close(in_pipe[1]);
-            alarm(3);
-            if(additional_args[1]!=NULL)
-                {
-                    if(execv(target_program,additional_args)==-1)
-                        error_handler("Execv");
-                }
-                else{
-                    if(execl(target_program,target_program,NULL)==-1)
-                        error_handler("Execlp");
-                }
-           }
-           else // read ERROR from pipe/ write input into the pipe
-           {
-                
-                close(in_pipe[0]);
-                close(in_pipe[1]);
-                close(e_pipe[1]);
-                //alarm(3);
-                
-                
-           }
-           int status;
-           waitpid(child_pid,&status,0);
-           char error_buff[BUFSIZE];
-           if (WIFEXITED(status))
-                {
-                    alarm(0);
-                    #ifdef DEBUG
-                    printf("Child process exited with status %d\n", WEXITSTATUS(status));
-                    #endif
-                }
-            if(read(e_pipe[0],error_buff,BUFSIZE)==-1)
-                {
-                    error_handler("Reading From pipe");
-                }
-            #ifdef DEBUG
-            printf("Error content: %s\n",error_buff);
-            #endif 
-            close(e_pipe[0]);
-            
-            if(strstr(error_buff,error_msg)!=NULL)
-            {
-                kill(child_pid,SIGKILL);
-                char * final_result = reduce(candidate);
-                reduced_result = final_result;
-                return(final_result);
-            }
-            free(candidate);               
+// Sliding window search: for every window size s from the largest down, try
+// deleting each window and then keeping only each window. Any success restarts
+// the search on the smaller input.
+void reduce_window(void)
+{
+    struct candidate next = { 0 };
+    struct window_ctx w;
+    w.t = &reduced_result;
+    w.s = resume_n(reduced_result.len - 1);
+    if(w.s>reduced_result.len - 1)
+        w.s = reduced_result.len - 1;
+
+    while(w.s>0)
+    {
+        progress.n = w.s;
+        checkpoint(0);
+        int hit = run_batch(2*(reduced_result.len-w.s),make_window_round,&w);
+        if(hit!=-1)
+            make_window_round(hit,&w,&next);
+
+        if(hit!=-1)
+        {
+            cand_copy(&next,&reduced_result);
+            w.s = reduced_result.len - 1;
         }
-        for(int i=0;i<strlen(tm)-s;i++)
+        else
+            w.s = w.s-1;
+    }
+}
+
+int positive_option(const char * name, char * arg)
+{
+    int value = atoi(arg);
+    if (value <= 0)
+    {
+        fprintf(stderr, "%s needs a positive value\n", name);
+        exit(EXIT_FAILURE);
+    }
+    return value;
+}
+
+// Comma separated tokenizer names for -s hier:levels
+void parse_levels(char * list)
+{
+    char * copy = strdup(list);
+    nlevels = 0;
+    for(char * name = strtok(copy,","); name != NULL; name = strtok(NULL,","))
+    {
+        const struct tokenizer * tok = find_tokenizer(name);
+        if (tok == NULL || nlevels == MAX_LEVELS)
         {
-            if(pipe(in_pipe)==-1)
-            {
-                error_handler("Inpipe open");
-            }
-            if(pipe(e_pipe)==-1)
-            {
-                error_handler("Error pipe open");
-            }
-           
-            char *mid;
-           mid = strndup(&tm[i],s);
-          
+            fprintf(stderr, "Bad level %s (line, token, byte; at most %d levels)\n", name, MAX_LEVELS);
+            exit(EXIT_FAILURE);
+        }
+        levels[nlevels++] = tok;
+    }
+    if (nlevels == 0)
+    {
+        fprintf(stderr, "-s hier: needs at least one level\n");
+        exit(EXIT_FAILURE);
+    }
+}
 
-           reduced_result = mid;
-           child_pid = fork();
+// ddmin works on units of the current input: bytes, or whatever a tokenizer
+// cut it into. cuts[i] is the offset of unit i; NULL means units are bytes.
+struct ddmin_ctx {
+    struct candidate * t;
+    size_t n;
+    size_t units;
+    size_t * cuts;
+};
 
-           if(child_pid==0)// error return , receive input
-           {
-            if(dup2(in_pipe[0],STDIN_FILENO) == -1)
-            {
-                error_handler("Redirecting pipe for STDIN");
-            }
-            if(dup2(e_pipe[1],STDERR_FILENO) == -1)
-            {
-                error_handler("Redirecting pipe for STDERR");
-            }
-            #ifdef DEBUG
-            printf("Candidate: %s\n",mid);
-            #endif
-                if(write(in_pipe[1],mid,strlen(mid))==-1)
-                {
-                    error_handler("Writing Thru PIPE_IN");
+size_t unit_offset(struct ddmin_ctx * d, size_t i)
+{
+    return d->cuts!=NULL ? d->cuts[i] : i;
+}
 
-                }
-            close(in_pipe[1]);
-            alarm(3);
-            if(additional_args[1]!=NULL)
-                {
-                    if(execv(target_program,additional_args)==-1)
-                        error_handler("Execv");
-                }
-                else{
-                    if(execl(target_program,target_program,NULL)==-1)
-                        error_handler("Execlp");
-                }
-           }
-           else // read ERROR from pipe/ write input into the pipe
-           {
-                
-                close(in_pipe[0]);
-                close(in_pipe[1]);
-                close(e_pipe[1]);
-                //alarm(3);
-                
-                
-           }
-           int status;
-           waitpid(child_pid,&status,0);
-           char error_buff[BUFSIZE];
-           if (WIFEXITED(status))
-                {
-                    alarm(0);
-                    #ifdef DEBUG
-                    printf("Child process exited with status %d\n", WEXITSTATUS(status));
-                    #endif
-                }
-            if(read(e_pipe[0],error_buff,BUFSIZE)==-1)
-                {
-                    error_handler("Reading From pipe");
-                }
-            #ifdef DEBUG
-            printf("Error content: %s\n",error_buff);
-            #endif
-            close(e_pipe[0]);
-            
-            if(strstr(error_buff,error_msg)!=NULL)
-            {
-                kill(child_pid,SIGKILL);
-                char * final_result = reduce(mid);
-                reduced_result = final_result;
-                return(final_result);
-            }
-            free(mid);               
+// Cuts the current input into units with tok
+void split_units(const struct tokenizer * tok, struct ddmin_ctx * d)
+{
+    if(tok->split==NULL)
+    {
+        d->units = d->t->len;
+        return;
+    }
+    char * buf = malloc(d->t->len);
+    d->cuts = realloc(d->cuts,(d->t->len+1)*sizeof(size_t));
+    if(buf==NULL || d->cuts==NULL)
+        error_handler("Allocating units");
+    cand_flatten(d->t,buf);
+    d->units = tok->split(buf,d->t->len,d->cuts);
+    free(buf);
+}
+
+// Bounds of chunk i when len bytes are split into n nearly equal chunks
+void chunk_bounds(size_t len, size_t n, size_t i, size_t * start, size_t * end)
+{
+    *start = i*(len/n) + (i < len%n ? i : len%n);
+    *end = *start + len/n + (i < len%n);
+}
+
+// Byte range of chunk i of a ddmin batch
+void ddmin_chunk(struct ddmin_ctx * d, int i, size_t * start, size_t * end)
+{
+    size_t first, last;
+    chunk_bounds(d->units,d->n,i,&first,&last);
+    *start = unit_offset(d,first);
+    *end = unit_offset(d,last);
+}
+
+// Candidate i of a ddmin batch: chunk i on its own
+void make_subset(int i, void * ctx, struct candidate * out)
+{
+    struct ddmin_ctx * d = ctx;
+    size_t start, end;
+    ddmin_chunk(d,i,&start,&end);
+    cand_slice(d->t,start,end,out);
+}
+
+// Candidate i of a ddmin batch: everything but chunk i
+void make_complement(int i, void * ctx, struct candidate * out)
+{
+    struct ddmin_ctx * d = ctx;
+    size_t start, end;
+    ddmin_chunk(d,i,&start,&end);
+    cand_cut(d->t,start,end,out);
+}
+
+// Candidate i of a ddmin round: the n chunks first, then the n complements,
+// which are left out with two chunks since they are the chunks themselves
+void make_round(int i, void * ctx, struct candidate * out)
+{
+    struct ddmin_ctx * d = ctx;
+    if(i<(int)d->n)
+        make_subset(i,ctx,out);
+    else
+        make_complement(i-d->n,ctx,out);
+}
+
+// Zeller's ddmin over the units tok cuts the input into: split them into n
+// chunks, test each chunk on its own and then each complement. A success
+// continues on the smaller input, cut again (n = 2 for a chunk, n - 1 for a
+// complement); otherwise the granularity doubles until every chunk is a
+// single unit. -s hier runs this once per level, lines before tokens before
+// bytes, so the coarse levels throw away most of the input in few runs and
+// the byte level only polishes what is left.
+void reduce_ddmin(const struct tokenizer * tok)
+{
+    struct candidate next = { 0 };
+    struct ddmin_ctx d;
+    d.t = &reduced_result;
+    d.cuts = NULL;
+    split_units(tok,&d);
+    d.n = resume_n(2);
+    if(d.n<2)
+        d.n = 2;
+    if(d.n>d.units)
+        d.n = d.units;
+
+    while(d.units>=2)
+    {
+        progress.n = d.n;
+        checkpoint(0);
+        // All chunks and complements of a round go out as one batch, so
+        // that with -j the complements run alongside the chunks
+        int hit = run_batch(d.n>2 ? 2*d.n : d.n,make_round,&d);
+        if(hit!=-1)
+        {
+            size_t next_n = hit<(int)d.n ? 2 : (d.n-1 > 2 ? d.n-1 : 2);
+            make_round(hit,&d,&next);
+            cand_copy(&next,&reduced_result);
+            split_units(tok,&d);
+            d.n = next_n < d.units ? next_n : d.units;
         }
-        s = s-1;
+        else if(d.n<d.units)
+            d.n = 2*d.n < d.units ? 2*d.n : d.units;
+        else
+            break;
     }
-    return tm;
+    free(d.cuts);
 }
 
 void error_handler(char * str)
@@ -292,26 +640,24 @@ void error_handler(char * str)
 }
 
 
+// CTRL + C only sets a flag. The checkpoint uses stdio, malloc and the cache,
+// which the signal may have interrupted halfway, so run_batch() writes it
+// when it next comes around its loop, with the state in one piece.
+volatile sig_atomic_t interrupted = 0;
+
 void int_handler(int sig)
 {
     if(sig == SIGINT)
-    {
-        kill(child_pid,SIGKILL);
-        printf("Size of current crashing input: %lu",strlen(reduced_result));
-        fwrite(reduced_result,1,strlen(reduced_result),out_fp);
-        exit(0);
-    }
-    
+        interrupted = 1;
 }
 
-void alrm_handler(int sig)
+void stop_interrupted(void)
 {
-    if(sig == SIGALRM)
-    {
-        kill(child_pid,SIGKILL);
-        printf("TIMEOUT!\n");
-        fwrite(reduced_result,1,strlen(reduced_result),out_fp);
-        fclose(out_fp);
-        exit(0);
-    }
-}
\ No newline at end of file
+    kill_children();
+    if(!baseline_passed)
+        error_handler("Interrupted before the initial input was checked");
+    checkpoint(1);
+    printf("Size of current crashing input: %zu (continue with --resume)\n",reduced_result.len);
+    cand_fwrite(&reduced_result,out_fp);
+    exit(0);
+}
@@ -0,0 +1,164 @@
+//21800637 Jooyoung Jang 
+//21600415 Sehyuk Yang
+#ifndef CIMIN_H
+#define CIMIN_H
+
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/types.h>
+
+#define BUFSIZE 4096
+#define MAX_JOBS 256
+
+extern char * error_msg;
+extern char * target_program;
+extern char ** additional_args;
+enum { EXEC_FORK, EXEC_SPAWN, EXEC_FORKSRV, EXEC_PERSIST, EXEC_REMOTE };
+
+extern int jobs;
+extern int exec_mode;
+extern int exec_count;
+extern int timeout_ms;
+extern int timeout_count;
+extern int cancel_count;
+extern int cache_hits;
+extern int cache_misses;
+extern long target_ms;
+extern int target_runs;
+extern int progress_seconds;
+extern int limit_mem_mb;
+extern int limit_cpu_s;
+extern int limit_fsize_mb;
+extern int limit_count;
+extern int oracle_signal;
+extern int oracle_exit;
+extern int stack_frames;
+extern uint64_t stack_reference;
+extern char * remote_addr;
+
+struct cache_key {
+    uint64_t h1;
+    uint64_t h2;
+    size_t len;
+};
+
+// A byte string that may contain NULs
+struct buffer {
+    char * data;
+    size_t len;
+};
+
+// A range of the original input
+struct span {
+    size_t off;
+    size_t len;
+};
+
+// A candidate input: the concatenation of its spans
+struct candidate {
+    struct span * spans;
+    int count;
+    int capacity;
+    size_t len;
+};
+
+extern struct buffer original;
+extern struct candidate reduced_result;
+extern char * strategy_name;
+extern double timeout_factor;
+
+// Where the reduction is, for checkpoints: the step of the strategy (the
+// hier level; for hdd 0 is the tree pass and 1 the byte pass), the hdd
+// depth and operation, and the ddmin granularity or the window size
+struct progress {
+    int step;
+    int depth;
+    int op;
+    size_t n;
+};
+
+extern char * checkpoint_file;
+extern struct progress progress;
+extern int resuming;
+extern int baseline_passed;
+extern volatile sig_atomic_t interrupted;
+
+// Builds candidate i of a batch into out
+typedef void (*candidate_fn)(int i, void * ctx, struct candidate * out);
+
+int run_batch(int n, candidate_fn make, void * ctx);
+void kill_children(void);
+void stop_interrupted(void);
+
+pid_t persist_run(int i, const struct candidate * c, int * err_fd);
+int persist_fd(int i);
+int persist_done(int i);
+int persist_stop(int i);
+
+struct pollfd;
+int remote_ready(int i);
+void remote_service(void);
+int remote_poll_fds(struct pollfd * fds);
+int remote_poll_timeout(void);
+void remote_wait(void);
+int remote_run(int i, const struct candidate * c);
+int remote_feed(int i);
+int remote_fd(int i);
+int remote_result(int i);
+void remote_cancel(int i);
+void remote_drop(int i);
+void run_worker(const char * addr);
+
+void cand_reserve(struct candidate * c, int count);
+void cand_whole(struct candidate * out);
+void cand_copy(const struct candidate * from, struct candidate * out);
+void cand_slice(const struct candidate * from, size_t start, size_t end, struct candidate * out);
+void cand_cut(const struct candidate * from, size_t start, size_t end, struct candidate * out);
+void cand_cut_many(const struct candidate * from, const struct span * cuts, int n, struct candidate * out);
+ssize_t cand_write(int fd, const struct candidate * c, int * span, size_t * off);
+void cand_fwrite(const struct candidate * c, FILE * fp);
+void cand_flatten(const struct candidate * c, char * buf);
+
+// Splits data into the units one level of hierarchical reduction works on:
+// writes the offset of every unit followed by len into cuts (len+1 entries)
+// and returns the number of units. A NULL split means single bytes.
+typedef size_t (*tokenizer_fn)(const char * data, size_t len, size_t * cuts);
+
+struct tokenizer {
+    const char * name;
+    tokenizer_fn split;
+};
+
+const struct tokenizer * find_tokenizer(const char * name);
+
+void checkpoint(int force);
+void load_checkpoint(void);
+size_t resume_n(size_t fresh);
+
+void apply_limits(pid_t pid, int cpu);
+void note_limit(int status);
+
+int parse_signal(const char * name);
+int oracle_status(int status);
+int oracle_stack(const char * report, size_t len);
+uint64_t oracle_id(void);
+
+void stats_begin(void);
+void show_progress(void);
+void write_stats(const char * path, const char * input, const char * output, double wall, double cpu);
+
+void run_corpus(const char * in_dir, const char * out_dir, char ** options);
+
+void chunk_bounds(size_t len, size_t n, size_t i, size_t * start, size_t * end);
+void reduce_hdd(struct candidate * t);
+void reduce_probdd(const struct tokenizer * tok);
+
+struct cache_key cache_hash(const struct candidate * c);
+int cache_lookup(struct cache_key * key);
+void cache_insert(struct cache_key * key, int verdict);
+int cache_save(FILE * fp);
+int cache_load(FILE * fp);
+void error_handler(char * str);
+
+#endif
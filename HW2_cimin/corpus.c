@@ -0,0 +1,324 @@
+//21800637 Jooyoung Jang 
+//21600415 Sehyuk Yang
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <dirent.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include "cimin.h"
+
+// Batch mode (-I dir -O dir): every regular file in the input directory is
+// minimized by a cimin process of its own, started with the same options.
+// The -j budget is shared through a jobserver pipe: every process owns one
+// job and needs a token from the pipe for each further child, so the jobs
+// of finished or sequential minimizations go to the ones that can use them.
+// Every process keeps the number of tokens it holds at its index in a shared
+// held file, so the tokens of one that dies without handing them back are not
+// lost. Results are stored under their content hash, so duplicates share one
+// file, and manifest.tsv lists what became of every input.
+
+struct entry {
+    char * name;
+    pid_t pid;
+    int done;
+    double start;
+    double seconds;
+    int status;
+    size_t size;
+    size_t result_size;
+    int executions;
+    struct cache_key key;
+    int duplicate_of;
+};
+
+// "read,write,held" for CIMIN_JOBSERVER, the index is added per process
+static char jobserver[48];
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return ts.tv_sec + ts.tv_nsec/1e9;
+}
+
+static int regular_file(const struct dirent * d)
+{
+    return d->d_type==DT_REG || d->d_type==DT_UNKNOWN;
+}
+
+// Content hash of a file, the same hash the cache uses
+static struct cache_key hash_file(const char * path, size_t * size)
+{
+    struct cache_key key = { 0, 0, 0 };
+    struct candidate c = { 0 };
+    struct stat st;
+    int fd = open(path,O_RDONLY);
+
+    *size = 0;
+    if(fd==-1 || fstat(fd,&st)==-1 || st.st_size==0)
+    {
+        if(fd!=-1)
+            close(fd);
+        return key;
+    }
+    original.len = *size = st.st_size;
+    original.data = mmap(NULL,original.len,PROT_READ,MAP_PRIVATE,fd,0);
+    close(fd);
+    if(original.data==MAP_FAILED)
+        return key;
+    cand_whole(&c);
+    key = cache_hash(&c);
+    munmap(original.data,original.len);
+    free(c.spans);
+    return key;
+}
+
+// Executions reported in a cimin log, -1 if there are none
+static int log_executions(const char * path)
+{
+    char line[BUFSIZE];
+    int executions = -1;
+    FILE * fp = fopen(path,"r");
+    if(fp==NULL)
+        return -1;
+    while(fgets(line,sizeof(line),fp)!=NULL)
+        sscanf(line,"Executions: %d",&executions);
+    fclose(fp);
+    return executions;
+}
+
+static pid_t start_one(struct entry * e, int index, const char * in_dir, const char * out_dir, char ** options)
+{
+    char * input, * output, * log;
+    int nopt = 0;
+    while(options[nopt]!=NULL)
+        nopt++;
+    int nargs = 0;
+    while(additional_args[nargs]!=NULL)
+        nargs++;
+
+    asprintf(&input,"%s/%s",in_dir,e->name);
+    asprintf(&output,"%s/.cimin/%d.out",out_dir,index);
+    asprintf(&log,"%s/.cimin/%d.log",out_dir,index);
+
+    char ** argv = calloc(nopt+nargs+8,sizeof(char *));
+    int k = 0;
+    argv[k++] = "cimin";
+    memcpy(argv+k,options,nopt*sizeof(char *));
+    k += nopt;
+    argv[k++] = "-i";
+    argv[k++] = input;
+    argv[k++] = "-o";
+    argv[k++] = output;
+    memcpy(argv+k,additional_args,nargs*sizeof(char *));
+
+    e->start = now();
+    pid_t pid = fork();
+    if(pid==0)
+    {
+        int fd = open(log,O_WRONLY|O_CREAT|O_TRUNC,0644);
+        if(fd==-1)
+            error_handler("Opening a batch log");
+        dup2(fd,STDOUT_FILENO);
+        dup2(fd,STDERR_FILENO);
+        signal(SIGINT,SIG_DFL);
+        char env[64];
+        snprintf(env,sizeof(env),"%s,%d",jobserver,index);
+        setenv("CIMIN_JOBSERVER",env,1);
+        execv("/proc/self/exe",argv);
+        error_handler("Execv");
+    }
+    else if(pid==-1)
+    {
+        error_handler("Fork");
+    }
+    free(argv);
+    free(input);
+    free(output);
+    free(log);
+    return pid;
+}
+
+// Moves a finished minimization's result to its hash name and notes it
+static void finish_one(struct entry * entries, int index, const char * out_dir)
+{
+    struct entry * e = &entries[index];
+    char * output, * log, * name;
+
+    asprintf(&output,"%s/.cimin/%d.out",out_dir,index);
+    asprintf(&log,"%s/.cimin/%d.log",out_dir,index);
+    e->executions = log_executions(log);
+    e->duplicate_of = -1;
+    if(!WIFEXITED(e->status) || WEXITSTATUS(e->status)!=0)
+    {
+        unlink(output);
+        free(output);
+        free(log);
+        return;
+    }
+
+    e->key = hash_file(output,&e->result_size);
+    // The first result with these contents keeps the file
+    for(int i=0;entries[i].name!=NULL && e->duplicate_of==-1;i++)
+    {
+        if(i!=index && entries[i].done && entries[i].duplicate_of==-1 && WIFEXITED(entries[i].status)
+           && WEXITSTATUS(entries[i].status)==0 && memcmp(&entries[i].key,&e->key,sizeof(e->key))==0)
+            e->duplicate_of = i;
+    }
+    asprintf(&name,"%s/%016llx%016llx.min",out_dir,(unsigned long long)e->key.h1,(unsigned long long)e->key.h2);
+    if(e->duplicate_of!=-1)
+        unlink(output);
+    else if(rename(output,name)==-1)
+        error_handler("Storing a batch result");
+    free(name);
+    free(output);
+    free(log);
+}
+
+static void write_manifest(struct entry * entries, int n, const char * out_dir)
+{
+    char * path;
+    asprintf(&path,"%s/manifest.tsv",out_dir);
+    FILE * fp = fopen(path,"w");
+    if(fp==NULL)
+        error_handler("Writing the manifest");
+    fprintf(fp,"input\tstatus\tbytes\tresult_bytes\texecutions\tseconds\tresult\tduplicate_of\n");
+    for(int i=0;i<n;i++)
+    {
+        struct entry * e = &entries[i];
+        int ok = WIFEXITED(e->status) && WEXITSTATUS(e->status)==0;
+        fprintf(fp,"%s\t%s\t%zu\t",e->name,ok ? "ok" : "failed",e->size);
+        if(ok)
+            fprintf(fp,"%zu\t%d\t%.3f\t%016llx%016llx.min\t%s\n",e->result_size,e->executions,e->seconds,
+                    (unsigned long long)e->key.h1,(unsigned long long)e->key.h2,
+                    e->duplicate_of!=-1 ? entries[e->duplicate_of].name : "-");
+        else
+            fprintf(fp,"-\t%d\t%.3f\t-\t-\n",e->executions,e->seconds);
+    }
+    fclose(fp);
+    free(path);
+}
+
+void run_corpus(const char * in_dir, const char * out_dir, char ** options)
+{
+    struct dirent ** list;
+    int n = scandir(in_dir,&list,regular_file,alphasort);
+    if(n==-1)
+        error_handler("Reading the input directory");
+    if(n==0)
+        error_handler("The input directory has no files");
+
+    char * work;
+    asprintf(&work,"%s/.cimin",out_dir);
+    if((mkdir(out_dir,0755)==-1 && errno!=EEXIST) || (mkdir(work,0755)==-1 && errno!=EEXIST))
+        error_handler("Creating the output directory");
+
+    struct entry * entries = calloc(n+1,sizeof(struct entry));
+    for(int i=0;i<n;i++)
+    {
+        struct stat st;
+        char * path;
+        entries[i].name = strdup(list[i]->d_name);
+        asprintf(&path,"%s/%s",in_dir,list[i]->d_name);
+        if(stat(path,&st)==0)
+            entries[i].size = st.st_size;
+        free(path);
+        free(list[i]);
+    }
+    free(list);
+
+    // One job per running process, the rest of the budget in the pipe
+    int js[2];
+    int procs = jobs < n ? jobs : n;
+    if(pipe(js)==-1)
+        error_handler("Jobserver pipe");
+    fcntl(js[0],F_SETFL,O_NONBLOCK);
+    for(int i=procs;i<jobs;i++)
+    {
+        if(write(js[1],"+",1)!=1)
+            error_handler("Jobserver pipe");
+    }
+    int held = memfd_create("cimin-jobs",0);
+    if(held!=-1 && ftruncate(held,n*sizeof(int))==-1)
+    {
+        close(held);
+        held = -1;
+    }
+    snprintf(jobserver,sizeof(jobserver),"%d,%d,%d",js[0],js[1],held);
+
+    int next = 0;
+    int alive = 0;
+    int failed = 0;
+    double start = now();
+    for(;next<procs;next++,alive++)
+        entries[next].pid = start_one(&entries[next],next,in_dir,out_dir,options);
+
+    while(alive>0)
+    {
+        int status;
+        pid_t pid = wait(&status);
+        if(pid==-1)
+        {
+            if(errno==EINTR)
+                continue;
+            error_handler("Waiting for a minimization");
+        }
+        int i;
+        for(i=0;i<n && entries[i].pid!=pid;i++)
+            ;
+        if(i==n)
+            continue;
+        entries[i].pid = 0;
+        entries[i].done = 1;
+        entries[i].status = status;
+        entries[i].seconds = now()-entries[i].start;
+        finish_one(entries,i,out_dir);
+        failed += !WIFEXITED(status) || WEXITSTATUS(status)!=0;
+
+        // A process that exits hands its tokens back itself; the ones still
+        // noted were held by a process that was killed
+        int tokens = 0;
+        if(held!=-1 && pread(held,&tokens,sizeof(tokens),i*sizeof(tokens))==sizeof(tokens))
+        {
+            for(;tokens>0;tokens--)
+            {
+                if(write(js[1],"+",1)!=1)
+                    error_handler("Jobserver pipe");
+            }
+        }
+
+        printf("[%d/%d] %s: %s\n",i+1,n,entries[i].name,
+               !WIFEXITED(status) || WEXITSTATUS(status)!=0 ? "failed" :
+               entries[i].duplicate_of!=-1 ? "duplicate" : "done");
+
+        // The finished process's own job goes to the next input, or back
+        // into the pipe for the minimizations still running
+        if(next<n)
+        {
+            entries[next].pid = start_one(&entries[next],next,in_dir,out_dir,options);
+            next++;
+        }
+        else
+        {
+            alive--;
+            if(write(js[1],"+",1)!=1)
+                error_handler("Jobserver pipe");
+        }
+    }
+
+    write_manifest(entries,n,out_dir);
+    int unique = 0;
+    for(int i=0;i<n;i++)
+        unique += entries[i].duplicate_of==-1 && WIFEXITED(entries[i].status) && WEXITSTATUS(entries[i].status)==0;
+    printf("Minimized %d inputs in %.3f s: %d unique results, %d failed (logs in %s)\n",
+           n,now()-start,unique,failed,work);
+    free(work);
+}
@@ -0,0 +1,109 @@
+//21800637 Jooyoung Jang 
+//21600415 Sehyuk Yang
+//
+// Fork server stub for cimin -x forksrv. Loaded into the target with
+// LD_PRELOAD, it takes over __libc_start_main so that the target is fully
+// loaded, linked and initialized once, and then parks in front of main().
+// For every candidate cimin sends the stdin and stderr descriptors over the
+// control socket; the stub forks, the child continues into main() with them,
+// and the parent reports the child's pid and wait status back.
+#define _GNU_SOURCE
+#include <dlfcn.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+typedef int (*main_fn)(int, char **, char **);
+typedef int (*start_fn)(main_fn, int, char **, void (*)(void), void (*)(void), void (*)(void), void *);
+
+static main_fn real_main;
+static rlim_t cpu_limit = 0;
+
+static int receive_fds(int ctl, int * fds)
+{
+    char byte;
+    struct iovec iov = { &byte, 1 };
+    char control[CMSG_SPACE(2 * sizeof(int))];
+    struct msghdr msg;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    if (recvmsg(ctl, &msg, 0) <= 0)
+        return -1;
+
+    struct cmsghdr * cmsg = CMSG_FIRSTHDR(&msg);
+    if (cmsg == NULL || cmsg->cmsg_type != SCM_RIGHTS)
+        return -1;
+    memcpy(fds, CMSG_DATA(cmsg), 2 * sizeof(int));
+    return 0;
+}
+
+static void serve(int ctl)
+{
+    for (;;)
+    {
+        int fds[2];
+        if (receive_fds(ctl, fds) == -1)
+            _exit(0);
+
+        pid_t pid = fork();
+        if (pid == 0)
+        {
+            close(ctl);
+            dup2(fds[0], STDIN_FILENO);
+            dup2(fds[1], STDERR_FILENO);
+            close(fds[0]);
+            close(fds[1]);
+            signal(SIGCHLD, SIG_DFL);
+            if (cpu_limit > 0)
+            {
+                struct rlimit rl = { cpu_limit, cpu_limit + 1 };
+                setrlimit(RLIMIT_CPU, &rl);
+            }
+            return;
+        }
+        close(fds[0]);
+        close(fds[1]);
+
+        int status = 0;
+        if (write(ctl, &pid, sizeof(pid)) != sizeof(pid))
+            _exit(1);
+        if (pid > 0)
+            waitpid(pid, &status, 0);
+        if (write(ctl, &status, sizeof(status)) != sizeof(status))
+            _exit(1);
+    }
+}
+
+static int forksrv_main(int argc, char ** argv, char ** envp)
+{
+    char * fd = getenv("CIMIN_FORKSRV_FD");
+    if (fd != NULL)
+    {
+        int ctl = atoi(fd);
+        unsetenv("CIMIN_FORKSRV_FD");
+        // cimin's --cpu, for every forked child
+        if (getenv("CIMIN_CPU_LIMIT") != NULL)
+        {
+            cpu_limit = atoi(getenv("CIMIN_CPU_LIMIT"));
+            unsetenv("CIMIN_CPU_LIMIT");
+        }
+        serve(ctl);
+    }
+    return real_main(argc, argv, envp);
+}
+
+int __libc_start_main(main_fn main, int argc, char ** argv, void (*init)(void),
+                      void (*fini)(void), void (*rtld_fini)(void), void * stack_end)
+{
+    start_fn real_start = (start_fn)dlsym(RTLD_NEXT, "__libc_start_main");
+    real_main = main;
+    return real_start(forksrv_main, argc, argv, init, fini, rtld_fini, stack_end);
+}
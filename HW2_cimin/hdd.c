@@ -0,0 +1,469 @@
+//21800637 Jooyoung Jang 
+//21600415 Sehyuk Yang
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "cimin.h"
+
+// Hierarchical delta debugging for -s hdd. JSON and XML inputs are parsed
+// into a tree, and ddmin runs over the nodes of one depth at a time, from the
+// root down: first removing nodes, then emptying JSON objects and arrays
+// ({...} becomes {}) or collapsing XML elements into their contents. The
+// input is parsed again after every success. The parsers are forgiving,
+// since crash inputs are rarely well formed: a stray closing bracket or tag
+// closes whatever is open, and anything left open runs to the end.
+
+// Every depth costs a parse and at least one run, so very deep inputs (a
+// common shape for parser crashes) are only walked this far and the rest is
+// left to the byte-level pass
+#define HDD_MAX_DEPTH 256
+
+enum { FMT_JSON, FMT_XML };
+enum { OP_DELETE, OP_HOLLOW };
+
+struct node {
+    size_t start;       // the whole node, with an object member's key
+    size_t end;
+    size_t in_start;    // what is between the brackets or tags; empty for
+    size_t in_end;      // scalars, text-less leaves and <empty/> elements
+    int parent;
+    int depth;
+};
+
+static char * text = NULL;
+static size_t text_len;
+static struct node * nodes = NULL;
+static int nnodes, nodes_cap;
+static int * stack = NULL;
+
+// Nodes ddmin works on at the current depth, and the ranges their edits cut
+static int * items = NULL;
+static int nitems;
+static char * edited = NULL;
+static struct span * cuts = NULL;
+static int ncuts;
+
+struct hdd_ctx {
+    struct candidate * t;
+    int format;
+    int op;
+    size_t n;
+};
+
+static int add_node(size_t start, int parent, int depth)
+{
+    if(nnodes==nodes_cap)
+    {
+        nodes_cap = nodes_cap ? 2*nodes_cap : 256;
+        nodes = realloc(nodes,nodes_cap*sizeof(struct node));
+        if(nodes==NULL)
+            error_handler("Growing the syntax tree");
+    }
+    struct node * nd = &nodes[nnodes];
+    nd->start = start;
+    nd->end = start;
+    nd->in_start = nd->in_end = 0;
+    nd->parent = parent;
+    nd->depth = depth;
+    return nnodes++;
+}
+
+static size_t skip_ws(size_t i)
+{
+    while(i<text_len && isspace((unsigned char)text[i]))
+        i++;
+    return i;
+}
+
+// End of the string or bare scalar at i, never i itself
+static size_t json_token(size_t i)
+{
+    if(text[i]=='"')
+    {
+        for(i++;i<text_len;i++)
+        {
+            if(text[i]=='\\')
+                i++;
+            else if(text[i]=='"')
+                return i+1;
+        }
+        return text_len;
+    }
+    size_t j = i;
+    while(j<text_len && memchr(",:{}[]\"",text[j],7)==NULL && !isspace((unsigned char)text[j]))
+        j++;
+    return j>i ? j : i+1;
+}
+
+// Every value is a node; an object member is one node from its key to the
+// end of its value. Iterative, so deeply nested crash inputs parse too.
+static void parse_json(void)
+{
+    int sp = 0;
+    size_t i = 0;
+    while((i = skip_ws(i))<text_len)
+    {
+        char c = text[i];
+        if(c==',' || c==':')
+        {
+            i++;
+            continue;
+        }
+        if(c=='}' || c==']')
+        {
+            if(sp>0)
+            {
+                int id = stack[--sp];
+                nodes[id].in_end = i;
+                nodes[id].end = i+1;
+            }
+            i++;
+            continue;
+        }
+
+        int parent = sp>0 ? stack[sp-1] : -1;
+        int id = add_node(i,parent,sp);
+        size_t j = i;
+        if(parent!=-1 && text[nodes[parent].in_start-1]=='{')
+        {
+            j = skip_ws(json_token(i));
+            if(j>=text_len || text[j]!=':')
+            {
+                nodes[id].end = json_token(i);
+                i = nodes[id].end;
+                continue;
+            }
+            j = skip_ws(j+1);
+            if(j>=text_len || text[j]=='}' || text[j]==',')
+            {
+                nodes[id].end = j;
+                i = j;
+                continue;
+            }
+        }
+        if(text[j]=='{' || text[j]=='[')
+        {
+            nodes[id].in_start = j+1;
+            stack[sp++] = id;
+            i = j+1;
+        }
+        else
+        {
+            nodes[id].end = json_token(j);
+            i = nodes[id].end;
+        }
+    }
+    while(sp>0)
+    {
+        int id = stack[--sp];
+        nodes[id].in_end = nodes[id].end = text_len;
+    }
+}
+
+// Index just past the first occurrence of s at or after i, or text_len
+static size_t past(size_t i, const char * s)
+{
+    size_t len = strlen(s);
+    for(;i+len<=text_len;i++)
+    {
+        if(memcmp(text+i,s,len)==0)
+            return i+len;
+    }
+    return text_len;
+}
+
+// Elements, comments, processing instructions and declarations are nodes;
+// text between them is left to the byte-level pass
+static void parse_xml(void)
+{
+    int sp = 0;
+    size_t i = 0;
+    while(i<text_len)
+    {
+        if(text[i]!='<')
+        {
+            char * lt = memchr(text+i,'<',text_len-i);
+            i = lt!=NULL ? (size_t)(lt-text) : text_len;
+            continue;
+        }
+        if(i+1<text_len && text[i+1]=='/')
+        {
+            size_t j = past(i,">");
+            if(sp>0)
+            {
+                int id = stack[--sp];
+                nodes[id].in_end = i;
+                nodes[id].end = j;
+            }
+            i = j;
+            continue;
+        }
+
+        int id = add_node(i,sp>0 ? stack[sp-1] : -1,sp);
+        if(i+3<text_len && memcmp(text+i,"<!--",4)==0)
+            i = past(i+4,"-->");
+        else if(i+8<text_len && memcmp(text+i,"<![CDATA[",9)==0)
+            i = past(i+9,"]]>");
+        else if(i+1<text_len && (text[i+1]=='!' || text[i+1]=='?'))
+            i = past(i,">");
+        else
+        {
+            // Start tag; quoted attribute values may contain '>'
+            char quote = 0;
+            size_t j;
+            for(j=i+1;j<text_len;j++)
+            {
+                if(quote)
+                    quote = text[j]==quote ? 0 : quote;
+                else if(text[j]=='"' || text[j]=='\'')
+                    quote = text[j];
+                else if(text[j]=='>')
+                    break;
+            }
+            if(j<text_len && text[j-1]!='/')
+            {
+                nodes[id].in_start = j+1;
+                stack[sp++] = id;
+            }
+            i = j<text_len ? j+1 : text_len;
+        }
+        nodes[id].end = i;
+    }
+    while(sp>0)
+    {
+        int id = stack[--sp];
+        nodes[id].in_end = nodes[id].end = text_len;
+    }
+}
+
+static void load(struct candidate * t)
+{
+    text = realloc(text,t->len+1);
+    stack = realloc(stack,(t->len+1)*sizeof(int));
+    if(text==NULL || stack==NULL)
+        error_handler("Parsing the input");
+    cand_flatten(t,text);
+    text_len = t->len;
+}
+
+static void parse(struct hdd_ctx * h)
+{
+    load(h->t);
+    nnodes = 0;
+    if(h->format==FMT_JSON)
+        parse_json();
+    else
+        parse_xml();
+}
+
+// The nodes at depth the operation can change, in input order
+static void gather(struct hdd_ctx * h, int depth)
+{
+    items = realloc(items,(nnodes+1)*sizeof(int));
+    edited = realloc(edited,nnodes+1);
+    cuts = realloc(cuts,(2*nnodes+1)*sizeof(struct span));
+    if(items==NULL || edited==NULL || cuts==NULL)
+        error_handler("Parsing the input");
+    nitems = 0;
+    for(int i=0;i<nnodes;i++)
+    {
+        if(nodes[i].depth!=depth)
+            continue;
+        if(h->op==OP_HOLLOW && nodes[i].in_end<=nodes[i].in_start)
+            continue;
+        items[nitems++] = i;
+    }
+}
+
+static void add_cut(size_t start, size_t end)
+{
+    if(end<=start)
+        return;
+    cuts[ncuts].off = start;
+    cuts[ncuts].len = end-start;
+    ncuts++;
+}
+
+// Removes the edited members among the siblings items[first..last) of a
+// JSON container, keeping exactly one comma between the members left
+static void cut_members(int first, int last)
+{
+    int parent = nodes[items[first]].parent;
+    size_t in_end = parent!=-1 ? nodes[parent].in_end : nodes[items[last-1]].end;
+    int kept = -1;
+
+    for(int k=first;k<last;k++)
+    {
+        if(edited[k])
+            continue;
+        if(kept==-1)
+            add_cut(nodes[items[first]].start,nodes[items[k]].start);
+        else if(k>kept+1)
+            add_cut(nodes[items[kept+1]].start,nodes[items[k]].start);
+        kept = k;
+    }
+    if(kept==-1)
+        add_cut(parent!=-1 ? nodes[parent].in_start : nodes[items[first]].start,in_end);
+    else if(kept<last-1)
+        add_cut(nodes[items[kept]].end,in_end);
+}
+
+// Builds the candidate that applies the operation to the items marked in
+// edited[]
+static void apply(struct hdd_ctx * h, struct candidate * out)
+{
+    ncuts = 0;
+    for(int k=0;k<nitems;)
+    {
+        struct node * nd = &nodes[items[k]];
+        if(h->op==OP_DELETE && h->format==FMT_JSON)
+        {
+            int last = k+1;
+            int any = edited[k];
+            while(last<nitems && nodes[items[last]].parent==nd->parent)
+                any |= edited[last++];
+            if(any)
+                cut_members(k,last);
+            k = last;
+            continue;
+        }
+        if(edited[k])
+        {
+            if(h->op==OP_DELETE)
+                add_cut(nd->start,nd->end);
+            else if(h->format==FMT_JSON)
+                add_cut(nd->in_start,nd->in_end);
+            else
+            {
+                add_cut(nd->start,nd->in_start);
+                add_cut(nd->in_end,nd->end);
+            }
+        }
+        k++;
+    }
+    cand_cut_many(h->t,cuts,ncuts,out);
+}
+
+// Candidate i of an hdd batch: only chunk i is kept as it is
+static void make_keep(int i, void * ctx, struct candidate * out)
+{
+    struct hdd_ctx * h = ctx;
+    size_t start, end;
+    chunk_bounds(nitems,h->n,i,&start,&end);
+    for(int k=0;k<nitems;k++)
+        edited[k] = k<(int)start || k>=(int)end;
+    apply(h,out);
+}
+
+// Candidate i of an hdd batch: the operation applied to chunk i
+static void make_edit(int i, void * ctx, struct candidate * out)
+{
+    struct hdd_ctx * h = ctx;
+    size_t start, end;
+    chunk_bounds(nitems,h->n,i,&start,&end);
+    for(int k=0;k<nitems;k++)
+        edited[k] = k>=(int)start && k<(int)end;
+    apply(h,out);
+}
+
+// Candidate i of an hdd round: the keeps first, then the edits, each left
+// out where it would only repeat the other kind or the input itself
+static int round_keeps(struct hdd_ctx * h)
+{
+    return h->n>1 ? h->n : 0;
+}
+
+static int round_edits(struct hdd_ctx * h)
+{
+    return h->n!=2 ? h->n : 0;
+}
+
+static void make_round(int i, void * ctx, struct candidate * out)
+{
+    struct hdd_ctx * h = ctx;
+    if(i<round_keeps(h))
+        make_keep(i,ctx,out);
+    else
+        make_edit(i-round_keeps(h),ctx,out);
+}
+
+// ddmin over the nodes at depth. Unlike byte-level ddmin a single node is
+// still worth trying, since editing it changes the input.
+static void hdd_level(struct hdd_ctx * h, int depth, int op)
+{
+    struct candidate next = { 0 };
+    h->op = op;
+    parse(h);
+    gather(h,depth);
+    h->n = resume_n(2);
+    if(h->n<1)
+        h->n = 1;
+    if(h->n>(size_t)nitems)
+        h->n = nitems;
+    progress.depth = depth;
+    progress.op = op;
+
+    while(nitems>0)
+    {
+        progress.n = h->n;
+        checkpoint(0);
+        // With two chunks keeping one is editing the other
+        int hit = run_batch(round_keeps(h)+round_edits(h),make_round,h);
+        if(hit!=-1)
+        {
+            size_t next_n = hit<round_keeps(h) ? 2 : (h->n-1 > 2 ? h->n-1 : 2);
+            make_round(hit,h,&next);
+            cand_copy(&next,h->t);
+            parse(h);
+            gather(h,depth);
+            h->n = next_n < (size_t)nitems ? next_n : (size_t)nitems;
+        }
+        else if(h->n<(size_t)nitems)
+            h->n = 2*h->n < (size_t)nitems ? 2*h->n : (size_t)nitems;
+        else
+            break;
+    }
+    free(next.spans);
+}
+
+// Reduces t in place if it looks like JSON or XML, and leaves it alone
+// otherwise; the caller finishes with byte-level ddmin either way
+void reduce_hdd(struct candidate * t)
+{
+    struct hdd_ctx h;
+    char first = 0;
+    h.t = t;
+
+    load(t);
+    size_t i = skip_ws(0);
+    if(i<text_len)
+        first = text[i];
+    if(first=='<')
+        h.format = FMT_XML;
+    else if(first=='{' || first=='[')
+        h.format = FMT_JSON;
+    else
+    {
+        #ifdef DEBUG
+        printf("hdd: input is neither JSON nor XML\n");
+        #endif
+        resuming = 0;
+        return;
+    }
+
+    // After --resume, start at the checkpointed depth and operation
+    int op = resuming ? progress.op : OP_DELETE;
+    for(int depth=resuming ? progress.depth : 0;depth<HDD_MAX_DEPTH;depth++)
+    {
+        for(;op<=OP_HOLLOW;op++)
+            hdd_level(&h,depth,op);
+        op = OP_DELETE;
+        parse(&h);
+        int deeper = 0;
+        for(int k=0;k<nnodes && !deeper;k++)
+            deeper = nodes[k].depth>depth;
+        if(!deeper)
+            break;
+    }
+}
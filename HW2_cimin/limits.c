@@ -0,0 +1,51 @@
+//21800637 Jooyoung Jang 
+//21600415 Sehyuk Yang
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include "cimin.h"
+
+// Resource limits for the targets (--mem, --cpu, --fsize), so that a
+// candidate that makes the target allocate without end, spin or fill the
+// disk stops on its own instead of dragging the machine down. Core dumps are
+// always off: cimin has no use for them and writing them slows every crash.
+
+int limit_mem_mb = 0;
+int limit_cpu_s = 0;
+int limit_fsize_mb = 0;
+int limit_count = 0;
+
+static void set_limit(pid_t pid, int resource, rlim_t soft, rlim_t hard)
+{
+    struct rlimit rl = { soft, hard };
+    if(prlimit(pid,resource,&rl,NULL)==-1 && errno!=ESRCH)
+        error_handler("Setting a resource limit");
+}
+
+// Applies the limits to pid (0 for the calling process), which may already
+// be gone if it was quick. The CPU limit only with cpu set, since it would
+// count the whole life of a long-lived process.
+void apply_limits(pid_t pid, int cpu)
+{
+    set_limit(pid,RLIMIT_CORE,0,0);
+    if(limit_mem_mb>0)
+        set_limit(pid,RLIMIT_AS,(rlim_t)limit_mem_mb<<20,(rlim_t)limit_mem_mb<<20);
+    if(limit_fsize_mb>0)
+        set_limit(pid,RLIMIT_FSIZE,(rlim_t)limit_fsize_mb<<20,(rlim_t)limit_fsize_mb<<20);
+    // SIGXCPU at the soft limit, SIGKILL a second later
+    if(cpu && limit_cpu_s>0)
+        set_limit(pid,RLIMIT_CPU,limit_cpu_s,limit_cpu_s+1);
+}
+
+// Counts a target that a limit killed, going by its wait status. Running out
+// of address space only makes allocations fail, so what happens then is up
+// to the target and not counted here.
+void note_limit(int status)
+{
+    if(WIFSIGNALED(status) && (WTERMSIG(status)==SIGXCPU || WTERMSIG(status)==SIGXFSZ))
+        limit_count++;
+}
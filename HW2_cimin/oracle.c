@@ -0,0 +1,144 @@
+//21800637 Jooyoung Jang 
+//21600415 Sehyuk Yang
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include "cimin.h"
+
+// What makes a candidate count as the crash, besides -m: the signal that
+// killed the target (--signal), its exit code (--exit), and the top frames of
+// the first stack in a sanitizer report (--stack N), compared with the
+// original input's. A candidate has to pass every oracle given. The wait
+// status is checked first, so the report is only parsed for candidates that
+// died the right way.
+
+int oracle_signal = 0;          // 0 for none, -1 for any signal
+int oracle_exit = -1;           // -1 for none
+int stack_frames = 0;           // 0 for no stack oracle
+uint64_t stack_reference = 0;   // the original's stack hash, 0 until known
+
+// A signal number, or a name with or without SIG; "any" for every signal
+int parse_signal(const char * name)
+{
+    if(strcmp(name,"any")==0)
+        return -1;
+    if(isdigit((unsigned char)name[0]))
+        return atoi(name)>0 && atoi(name)<NSIG ? atoi(name) : 0;
+    if(strncmp(name,"SIG",3)==0)
+        name += 3;
+    for(int sig=1;sig<NSIG;sig++)
+    {
+        const char * abbrev = sigabbrev_np(sig);
+        if(abbrev!=NULL && strcmp(abbrev,name)==0)
+            return sig;
+    }
+    return 0;
+}
+
+// The cheap part: whether the wait status is what --signal and --exit ask for
+int oracle_status(int status)
+{
+    if(oracle_signal!=0 && !(WIFSIGNALED(status) && (oracle_signal==-1 || WTERMSIG(status)==oracle_signal)))
+        return 0;
+    if(oracle_exit!=-1 && !(WIFEXITED(status) && WEXITSTATUS(status)==oracle_exit))
+        return 0;
+    return 1;
+}
+
+static uint64_t fnv(uint64_t h, const char * s, size_t len)
+{
+    for(size_t i=0;i<len;i++)
+        h = (h ^ (unsigned char)s[i]) * 0x100000001b3ULL;
+    return h;
+}
+
+// Hash of the first stack_frames frames of the first stack in a sanitizer
+// report, 0 if there is none. Frames are lines like
+//   #3 0x4f5a3c in jsmn_parse /src/jsmn.c:123:5
+//   #4 0x7f12e8029d90  (/lib/x86_64-linux-gnu/libc.so.6+0x29d90)
+// and count by their function, or by their module if there is no symbol, so
+// that addresses and line numbers may change.
+static uint64_t stack_hash(const char * report, size_t len)
+{
+    uint64_t h = 0xcbf29ce484222325ULL;
+    int frames = 0;
+    const char * end = report+len;
+    for(const char * line = report; line<end && frames<stack_frames; )
+    {
+        const char * eol = memchr(line,'\n',end-line);
+        if(eol==NULL)
+            eol = end;
+        const char * p = line;
+        while(p<eol && (*p==' ' || *p=='\t'))
+            p++;
+        char * q;
+        if(p<eol && *p=='#' && isdigit((unsigned char)p[1]))
+        {
+            long k = strtol(p+1,&q,10);
+            // A second #0 starts the next stack of the report
+            if(k==0 && frames>0)
+                break;
+            p = q;
+            while(p<eol && *p==' ')
+                p++;
+            if(eol-p>2 && strncmp(p,"0x",2)==0)
+            {
+                while(p<eol && *p!=' ')
+                    p++;
+                while(p<eol && *p==' ')
+                    p++;
+                const char * name = p;
+                const char * stop;
+                if(eol-p>3 && strncmp(p,"in ",3)==0)
+                {
+                    name = p+3;
+                    for(stop=name;stop<eol && *stop!=' ';stop++)
+                        ;
+                }
+                else
+                {
+                    for(stop=name;stop<eol && *stop!='+' && *stop!=')';stop++)
+                    {
+                        if(*stop=='/')
+                            name = stop+1;
+                    }
+                }
+                h = fnv(h,name,stop-name);
+                h = fnv(h,"\n",1);
+                frames++;
+            }
+        }
+        line = eol+1;
+    }
+    if(frames==0)
+        return 0;
+    return h ? h : 1;
+}
+
+// The expensive part: whether report has the original's stack. The first
+// report asked about is the original's own and becomes the reference.
+int oracle_stack(const char * report, size_t len)
+{
+    uint64_t h = stack_hash(report,len);
+    if(h==0)
+        return 0;
+    if(stack_reference==0)
+        stack_reference = h;
+    return h==stack_reference;
+}
+
+// Identifies the oracles in checkpoints, whose cached verdicts only hold for
+// the same ones
+uint64_t oracle_id(void)
+{
+    char config[64];
+    uint64_t h = 0xcbf29ce484222325ULL;
+    if(error_msg!=NULL)
+        h = fnv(h,error_msg,strlen(error_msg)+1);
+    snprintf(config,sizeof(config),"%d %d %d",oracle_signal,oracle_exit,stack_frames);
+    return fnv(h,config,strlen(config));
+}
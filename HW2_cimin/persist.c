@@ -0,0 +1,201 @@
+//21800637 Jooyoung Jang 
+//21600415 Sehyuk Yang
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <dlfcn.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include "cimin.h"
+
+// -x persist: the target is a shared library with the libFuzzer entry point
+// LLVMFuzzerTestOneInput. Every slot has a worker process that loads it once
+// and then runs candidates in a loop: cimin sends the length and the bytes
+// over a socket, the worker calls the entry point and answers with one byte.
+// A crash takes the worker down and a new one is started for the next
+// candidate; workers are also replaced every PERSIST_RUNS candidates so that
+// leaks and global state in the library cannot pile up forever.
+
+#define PERSIST_RUNS 10000
+
+typedef int (*test_fn)(const uint8_t * data, size_t size);
+typedef int (*init_fn)(int * argc, char *** argv);
+
+enum { WORKER_READY, WORKER_NO_LIBRARY, WORKER_NO_ENTRY };
+
+struct worker {
+    pid_t pid;
+    int ctl;
+    int err;
+    int runs;
+};
+
+static struct worker workers[MAX_JOBS];
+
+static int read_full(int fd, void * buf, size_t len)
+{
+    char * p = buf;
+    while(len>0)
+    {
+        ssize_t n = read(fd,p,len);
+        if(n<=0)
+        {
+            if(n==-1 && errno==EINTR)
+                continue;
+            return -1;
+        }
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+static void worker_main(int ctl)
+{
+    int argc = 0;
+    while(additional_args[argc]!=NULL)
+        argc++;
+    char ** argv = additional_args;
+    char * buf = NULL;
+    int state = WORKER_READY;
+
+    void * lib = dlopen(target_program,RTLD_NOW);
+    test_fn test = lib!=NULL ? (test_fn)dlsym(lib,"LLVMFuzzerTestOneInput") : NULL;
+    if(lib==NULL)
+        state = WORKER_NO_LIBRARY;
+    else if(test==NULL)
+        state = WORKER_NO_ENTRY;
+    if(write(ctl,&state,sizeof(state))!=sizeof(state) || state!=WORKER_READY)
+        _exit(1);
+
+    init_fn init = (init_fn)dlsym(lib,"LLVMFuzzerInitialize");
+    if(init!=NULL)
+        init(&argc,&argv);
+
+    for(;;)
+    {
+        size_t len;
+        if(read_full(ctl,&len,sizeof(len))==-1)
+            _exit(0);
+        buf = realloc(buf,len ? len : 1);
+        if(buf==NULL || read_full(ctl,buf,len)==-1)
+            _exit(0);
+        test((const uint8_t *)buf,len);
+        char done = 0;
+        if(write(ctl,&done,1)!=1)
+            _exit(0);
+    }
+}
+
+static void start_worker(int i)
+{
+    int sv[2];
+    int e_pipe[2];
+    if(socketpair(AF_UNIX,SOCK_STREAM|SOCK_CLOEXEC,0,sv)==-1)
+        error_handler("Worker socket");
+    if(pipe2(e_pipe,O_CLOEXEC)==-1)
+        error_handler("Error pipe open");
+
+    pid_t pid = fork();
+    if(pid==0)
+    {
+        int null_fd = open("/dev/null",O_RDONLY);
+        dup2(null_fd,STDIN_FILENO);
+        dup2(e_pipe[1],STDERR_FILENO);
+        // cimin's own handlers are no business of the worker
+        signal(SIGINT,SIG_DFL);
+        signal(SIGPIPE,SIG_DFL);
+        apply_limits(0,0);
+        close(sv[0]);
+        for(int k=0;k<MAX_JOBS;k++)
+        {
+            if(workers[k].pid!=0)
+            {
+                close(workers[k].ctl);
+                close(workers[k].err);
+            }
+        }
+        worker_main(sv[1]);
+    }
+    else if(pid==-1)
+    {
+        error_handler("Fork");
+    }
+    close(sv[1]);
+    close(e_pipe[1]);
+    fcntl(e_pipe[0],F_SETFL,O_NONBLOCK);
+
+    int state;
+    if(read_full(sv[0],&state,sizeof(state))==-1)
+        error_handler("Persistent worker died while loading the target");
+    if(state==WORKER_NO_LIBRARY)
+        error_handler("Cannot dlopen the target (-x persist needs a shared library)");
+    if(state==WORKER_NO_ENTRY)
+        error_handler("The target has no LLVMFuzzerTestOneInput");
+
+    workers[i].pid = pid;
+    workers[i].ctl = sv[0];
+    workers[i].err = e_pipe[0];
+    workers[i].runs = 0;
+}
+
+// Hands candidate c to slot i's worker, starting one if needed. Returns the
+// worker's pid and its stderr in *err_fd.
+pid_t persist_run(int i, const struct candidate * c, int * err_fd)
+{
+    int span = 0;
+    size_t off = 0;
+
+    if(workers[i].pid==0)
+        start_worker(i);
+    // A worker that dies half way shows up as EOF on the socket
+    if(write(workers[i].ctl,&c->len,sizeof(c->len))==sizeof(c->len))
+    {
+        while(span<c->count)
+        {
+            if(cand_write(workers[i].ctl,c,&span,&off)==-1 && errno!=EINTR)
+                break;
+        }
+    }
+    *err_fd = workers[i].err;
+    return workers[i].pid;
+}
+
+// Readable once slot i's worker has finished its candidate or died
+int persist_fd(int i)
+{
+    return workers[i].ctl;
+}
+
+// After persist_fd() turned readable: 1 if the worker finished the candidate
+// and stays for the next one, 2 if it finished its last one and is to be
+// retired with persist_stop(), 0 if it is gone
+int persist_done(int i)
+{
+    char done;
+    if(read(workers[i].ctl,&done,1)!=1)
+        return 0;
+    if(++workers[i].runs>=PERSIST_RUNS)
+        return 2;
+    return 1;
+}
+
+// Kills slot i's worker and returns its wait status
+int persist_stop(int i)
+{
+    int status = 0;
+    if(workers[i].pid==0)
+        return 0;
+    kill(workers[i].pid,SIGKILL);
+    waitpid(workers[i].pid,&status,0);
+    close(workers[i].ctl);
+    close(workers[i].err);
+    workers[i].pid = 0;
+    return status;
+}
@@ -0,0 +1,214 @@
+//21800637 Jooyoung Jang 
+//21600415 Sehyuk Yang
+#include <stdio.h>
+#include <stdlib.h>
+#include "cimin.h"
+
+// Probabilistic delta debugging for -s probdd (Wang et al., ProbDD). Every
+// unit of the input (byte, token or line) has a probability of being needed
+// for the crash, PROBDD_PRIOR at first. Each test deletes the units with the
+// lowest probabilities, as many as maximize the expected gain: k units go
+// away with a chance of the product of their (1 - p), so k times that product
+// is the number of units a test is expected to remove. A deletion that keeps
+// the crash removes the units for good. One that loses it tells that at
+// least one of them is needed, and each of their probabilities is divided by
+// the chance that the set was not removable; a unit deleted on its own
+// without success is needed for sure. A pass ends when every unit left is
+// known to be needed. Since those verdicts were taken on larger inputs,
+// passes repeat on the result until one removes nothing, which leaves an
+// input where no single unit can go (1-minimal, as ddmin's results are).
+//
+// A round tests PROBDD_BATCH disjoint deletion sets, the best one first. The
+// batch does not depend on -j, so the result does not either, and with -j
+// the sets run side by side.
+
+#define PROBDD_PRIOR 0.1
+#define PROBDD_BATCH 8
+// Only a unit deleted on its own is needed for sure; rounding must not
+// decide that for a larger set
+#define PROBDD_ALMOST 0.999
+
+struct probdd_ctx {
+    struct candidate * base;    // the input when the search started
+    size_t units;
+    size_t * cuts;              // offset of every unit in base, then base->len
+    double * p;
+    char * removed;
+    size_t * order;             // units still in question, lowest p first
+    size_t set_start[PROBDD_BATCH+1];   // set i is order[set_start[i]..set_start[i+1])
+    int sets;
+    char * chosen;              // set number + 1 of a unit in this round, or 0
+    struct span * spans;
+};
+
+static double * sort_p;
+
+static int by_probability(const void * a, const void * b)
+{
+    size_t x = *(const size_t *)a;
+    size_t y = *(const size_t *)b;
+    if(sort_p[x]!=sort_p[y])
+        return sort_p[x]<sort_p[y] ? -1 : 1;
+    return x<y ? -1 : x>y;
+}
+
+// Lays out the round's deletion sets: each takes, from the units the earlier
+// sets left, the prefix with the best expected gain. Returns the number of
+// sets, 0 when every unit left is needed.
+static int choose_sets(struct probdd_ctx * d)
+{
+    size_t n = 0;
+    for(size_t u=0;u<d->units;u++)
+    {
+        d->chosen[u] = 0;
+        if(!d->removed[u] && d->p[u]<1)
+            d->order[n++] = u;
+    }
+    sort_p = d->p;
+    qsort(d->order,n,sizeof(size_t),by_probability);
+
+    d->sets = 0;
+    size_t at = 0;
+    while(at<n && d->sets<PROBDD_BATCH)
+    {
+        double keep = 1, best = 0;
+        size_t best_k = 1;
+        for(size_t k=1;at+k<=n;k++)
+        {
+            keep *= 1-d->p[d->order[at+k-1]];
+            // With the lowest probabilities first the gain rises to a single
+            // peak and falls after it
+            if(k*keep<=best)
+                break;
+            best = k*keep;
+            best_k = k;
+        }
+        d->set_start[d->sets++] = at;
+        for(size_t k=0;k<best_k;k++)
+            d->chosen[d->order[at+k]] = d->sets;
+        at += best_k;
+    }
+    d->set_start[d->sets] = at;
+    return d->sets;
+}
+
+// Candidate i of a round: the input without the removed units and set i
+static void make_deletion(int i, void * ctx, struct candidate * out)
+{
+    struct probdd_ctx * d = ctx;
+    int n = 0;
+    for(size_t u=0;u<d->units;u++)
+    {
+        if(!d->removed[u] && d->chosen[u]!=i+1)
+            continue;
+        if(n>0 && d->spans[n-1].off+d->spans[n-1].len==d->cuts[u])
+            d->spans[n-1].len += d->cuts[u+1]-d->cuts[u];
+        else
+        {
+            d->spans[n].off = d->cuts[u];
+            d->spans[n].len = d->cuts[u+1]-d->cuts[u];
+            n++;
+        }
+    }
+    cand_cut_many(d->base,d->spans,n,out);
+}
+
+// A deletion set that lost the crash
+static void failed(struct probdd_ctx * d, int set)
+{
+    size_t first = d->set_start[set];
+    size_t last = d->set_start[set+1];
+    double keep = 1;
+    for(size_t k=first;k<last;k++)
+        keep *= 1-d->p[d->order[k]];
+    for(size_t k=first;k<last;k++)
+    {
+        size_t u = d->order[k];
+        d->p[u] = last-first==1 ? 1 : d->p[u]/(1-keep);
+        if(last-first>1 && d->p[u]>PROBDD_ALMOST)
+            d->p[u] = PROBDD_ALMOST;
+    }
+}
+
+// One pass over the current input; returns the number of units it removed
+static size_t probdd_pass(const struct tokenizer * tok)
+{
+    struct probdd_ctx d;
+    struct candidate base = { 0 };
+    struct candidate next = { 0 };
+    size_t gone = 0;
+
+    cand_copy(&reduced_result,&base);
+    d.base = &base;
+    d.cuts = malloc((base.len+1)*sizeof(size_t));
+    if(d.cuts==NULL)
+        error_handler("Allocating units");
+    if(tok->split!=NULL)
+    {
+        char * buf = malloc(base.len);
+        if(buf==NULL)
+            error_handler("Allocating units");
+        cand_flatten(&base,buf);
+        d.units = tok->split(buf,base.len,d.cuts);
+        free(buf);
+    }
+    else
+    {
+        d.units = base.len;
+        for(size_t u=0;u<=base.len;u++)
+            d.cuts[u] = u;
+    }
+
+    d.p = malloc(d.units*sizeof(double));
+    d.removed = calloc(d.units,1);
+    d.order = malloc(d.units*sizeof(size_t));
+    d.chosen = malloc(d.units);
+    d.spans = malloc(d.units*sizeof(struct span));
+    if(d.units>0 && (d.p==NULL || d.removed==NULL || d.order==NULL || d.chosen==NULL || d.spans==NULL))
+        error_handler("Allocating units");
+    for(size_t u=0;u<d.units;u++)
+        d.p[u] = PROBDD_PRIOR;
+    progress.n = 0;
+
+    while(choose_sets(&d)>0)
+    {
+        checkpoint(0);
+        int hit = run_batch(d.sets,make_deletion,&d);
+        // The sets before the hit all ran and lost the crash; the ones after
+        // it may not have run at all
+        for(int i=0;i<(hit==-1 ? d.sets : hit);i++)
+            failed(&d,i);
+        if(hit!=-1)
+        {
+            make_deletion(hit,&d,&next);
+            for(size_t u=0;u<d.units;u++)
+            {
+                if(d.chosen[u]==hit+1)
+                {
+                    d.removed[u] = 1;
+                    gone++;
+                }
+            }
+            cand_copy(&next,&reduced_result);
+        }
+    }
+
+    free(d.cuts);
+    free(d.p);
+    free(d.removed);
+    free(d.order);
+    free(d.chosen);
+    free(d.spans);
+    free(base.spans);
+    free(next.spans);
+    return gone;
+}
+
+void reduce_probdd(const struct tokenizer * tok)
+{
+    // The probabilities are not checkpointed; a resumed search starts them
+    // over on the checkpointed input
+    resume_n(0);
+    while(probdd_pass(tok)>0)
+        ;
+}
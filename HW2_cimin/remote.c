@@ -0,0 +1,531 @@
+//21800637 Jooyoung Jang 
+//21600415 Sehyuk Yang
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include "cimin.h"
+
+// Distributed mode. A coordinator (--listen ADDR) runs the search and hands
+// candidates to worker processes (--worker ADDR), which may connect at any
+// time, over a Unix socket (ADDR is a path) or TCP (host:port, where an empty
+// host means 127.0.0.1). A worker runs the target on its side, with its own
+// -x and resource limits, judges the outcome with the coordinator's oracles
+// and time limit, and answers with the verdict. A worker runs one candidate
+// at a time, so start one per core; -j caps how many the coordinator uses.
+//
+// Messages are fixed headers in host byte order, which the hello's magic
+// checks, followed by raw bytes:
+//   worker -> coordinator   hello: magic, version
+//   coordinator -> worker   config: --signal, --exit, --stack and -m's
+//                           length, then -m
+//   coordinator -> worker   job: stack reference, length, time limit (which
+//                           -t auto sets after the first job), then the
+//                           candidate
+//   worker -> coordinator   result: verdict, timeouts, limit kills, the
+//                           target's run time if it exited on its own (-1
+//                           otherwise), and the stack reference (set by the
+//                           original's run)
+// When a worker goes away, or does not answer long after the time limit it
+// keeps itself, its candidate is run again by another one. A cancelled
+// candidate cannot be stopped on the worker; the rest of it is still sent,
+// and its result is read and dropped before the worker gets the next one.
+
+#define REMOTE_MAGIC 0x434d4e31     // "CMN1"
+#define REMOTE_VERSION 2
+// How long a worker keeps trying to reach a coordinator that is not up yet
+#define CONNECT_TRIES 100
+#define CONNECT_PAUSE_US 100000
+// How long a worker has for its hello after connecting
+#define HELLO_MS 1000
+
+struct remote_hello {
+    uint32_t magic;
+    uint32_t version;
+};
+
+struct remote_config {
+    int32_t signal;
+    int32_t exit;
+    int32_t stack_frames;
+    int32_t msg_len;            // -1 without -m
+};
+
+struct remote_job {
+    uint64_t stack_reference;
+    uint64_t len;
+    int32_t timeout_ms;
+    int32_t pad;
+};
+
+struct remote_result {
+    int32_t verdict;
+    int32_t timeouts;
+    int32_t limits;
+    int32_t run_ms;
+    uint64_t stack_reference;
+};
+
+char * remote_addr = NULL;
+
+// A worker connection. The coordinator never blocks on one: the hello and
+// the results are read, and the jobs written, as far as the socket allows,
+// and the event loop comes back for the rest.
+enum { C_HELLO, C_IDLE, C_BUSY, C_STALE };
+
+struct conn {
+    int fd;                     // -1 for none
+    int state;
+    long hello_by;              // C_HELLO: dropped if still silent then
+    char in[sizeof(struct remote_result)];     // the hello or result so far
+    size_t in_len;
+    struct remote_job job;      // the job being sent
+    size_t job_sent;
+    const struct candidate * c;
+    int span;
+    size_t off;
+    int sending;
+};
+
+static int listen_fd = -1;
+static struct conn conns[MAX_JOBS];
+static char * unix_path = NULL;
+static pid_t path_owner;
+
+static int full_io(int fd, void * buf, size_t len, int out)
+{
+    char * p = buf;
+    while(len>0)
+    {
+        ssize_t n = out ? send(fd,p,len,MSG_NOSIGNAL) : read(fd,p,len);
+        if(n<=0)
+        {
+            if(n==-1 && errno==EINTR)
+                continue;
+            return -1;
+        }
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+// A Unix socket address for a path, or a TCP one for host:port. Returns the
+// socket's family, and fills in addr.
+static int parse_addr(const char * text, struct sockaddr_storage * addr, socklen_t * len)
+{
+    const char * colon = strrchr(text,':');
+    memset(addr,0,sizeof(*addr));
+    if(colon==NULL || strchr(text,'/')!=NULL)
+    {
+        struct sockaddr_un * un = (struct sockaddr_un *)addr;
+        if(strlen(text)>=sizeof(un->sun_path))
+            error_handler("Socket path too long");
+        un->sun_family = AF_UNIX;
+        strcpy(un->sun_path,text);
+        *len = sizeof(*un);
+        return AF_UNIX;
+    }
+
+    char host[256];
+    struct addrinfo hints, * res;
+    snprintf(host,sizeof(host),"%.*s",(int)(colon-text),text);
+    memset(&hints,0,sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if(getaddrinfo(host[0] ? host : "127.0.0.1",colon+1,&hints,&res)!=0)
+        error_handler("Resolving the coordinator address");
+    memcpy(addr,res->ai_addr,res->ai_addrlen);
+    *len = res->ai_addrlen;
+    freeaddrinfo(res);
+    return addr->ss_family;
+}
+
+static void remove_socket(void)
+{
+    if(getpid()==path_owner)
+        unlink(unix_path);
+}
+
+static long now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return ts.tv_sec*1000L + ts.tv_nsec/1000000;
+}
+
+// Opens the coordinator's listening socket
+static void start_listening(void)
+{
+    struct sockaddr_storage addr;
+    socklen_t len;
+    int family = parse_addr(remote_addr,&addr,&len);
+    int one = 1;
+
+    for(int i=0;i<MAX_JOBS;i++)
+        conns[i].fd = -1;
+    listen_fd = socket(family,SOCK_STREAM|SOCK_CLOEXEC|SOCK_NONBLOCK,0);
+    if(listen_fd==-1)
+        error_handler("Coordinator socket");
+    if(family==AF_UNIX)
+    {
+        unix_path = remote_addr;
+        unlink(unix_path);
+        path_owner = getpid();
+        atexit(remove_socket);
+    }
+    else
+        setsockopt(listen_fd,SOL_SOCKET,SO_REUSEADDR,&one,sizeof(one));
+    if(bind(listen_fd,(struct sockaddr *)&addr,len)==-1 || listen(listen_fd,SOMAXCONN)==-1)
+        error_handler("Listening for workers");
+}
+
+static void drop(int i)
+{
+    close(conns[i].fd);
+    conns[i].fd = -1;
+}
+
+// Takes in the workers that have connected, as long as -j leaves room; they
+// are used once their hello is in
+static void accept_workers(void)
+{
+    int fd;
+    while((fd = accept4(listen_fd,NULL,NULL,SOCK_CLOEXEC|SOCK_NONBLOCK))!=-1)
+    {
+        int i;
+        int one = 1;
+        for(i=0;i<jobs && conns[i].fd!=-1;i++)
+            ;
+        if(i==jobs)
+        {
+            close(fd);
+            continue;
+        }
+        setsockopt(fd,IPPROTO_TCP,TCP_NODELAY,&one,sizeof(one));
+        conns[i].fd = fd;
+        conns[i].state = C_HELLO;
+        conns[i].hello_by = now_ms()+HELLO_MS;
+        conns[i].in_len = 0;
+    }
+}
+
+// Reads what has arrived of a len byte message; 1 once it is complete, 0
+// if more is to come, -1 if the worker is gone
+static int read_message(int i, size_t len)
+{
+    struct conn * w = &conns[i];
+    while(w->in_len<len)
+    {
+        ssize_t n = read(w->fd,w->in+w->in_len,len-w->in_len);
+        if(n==0)
+            return -1;
+        if(n==-1)
+            return errno==EAGAIN || errno==EINTR ? 0 : -1;
+        w->in_len += n;
+    }
+    w->in_len = 0;
+    return 1;
+}
+
+// Checks a worker's hello and sends it the configuration. The socket is
+// new and empty, so the configuration goes out whole or the worker is
+// dropped.
+static void greet(int i)
+{
+    struct conn * w = &conns[i];
+    int got = read_message(i,sizeof(struct remote_hello));
+    if(got==-1 || (got==0 && now_ms()>=w->hello_by))
+        drop(i);
+    if(got!=1)
+        return;
+    struct remote_hello hello;
+    memcpy(&hello,w->in,sizeof(hello));
+    struct remote_config config = { oracle_signal, oracle_exit, stack_frames,
+                                    error_msg!=NULL ? (int32_t)strlen(error_msg) : -1 };
+    size_t len = sizeof(config)+(config.msg_len>0 ? config.msg_len : 0);
+    char * msg = malloc(len);
+    if(msg==NULL)
+        error_handler("Allocating the worker configuration");
+    memcpy(msg,&config,sizeof(config));
+    if(config.msg_len>0)
+        memcpy(msg+sizeof(config),error_msg,config.msg_len);
+    if(hello.magic!=REMOTE_MAGIC || hello.version!=REMOTE_VERSION
+       || send(w->fd,msg,len,MSG_NOSIGNAL|MSG_DONTWAIT)!=(ssize_t)len)
+        drop(i);
+    else
+        w->state = C_IDLE;
+    free(msg);
+    #ifdef DEBUG
+    if(w->fd!=-1)
+        printf("Worker %d connected\n",i);
+    #endif
+}
+
+// Sends as much of the worker's job as the socket takes; 1 once all of it
+// is out, 0 if more is to go, -1 if the worker is gone
+static int write_job(int i)
+{
+    struct conn * w = &conns[i];
+    while(w->job_sent<sizeof(w->job))
+    {
+        ssize_t n = send(w->fd,(char *)&w->job+w->job_sent,sizeof(w->job)-w->job_sent,MSG_NOSIGNAL);
+        if(n==-1)
+            return errno==EAGAIN || errno==EINTR ? 0 : -1;
+        w->job_sent += n;
+    }
+    while(w->span<w->c->count)
+    {
+        if(cand_write(w->fd,w->c,&w->span,&w->off)==-1)
+            return errno==EAGAIN || errno==EINTR ? 0 : -1;
+    }
+    w->sending = 0;
+    return 1;
+}
+
+// Moves the connections the run loop does not look after along: new
+// workers are taken in and greeted, and workers with a cancelled candidate
+// get the rest of it and have its result dropped. Called after every poll.
+void remote_service(void)
+{
+    accept_workers();
+    for(int i=0;i<jobs;i++)
+    {
+        struct conn * w = &conns[i];
+        if(w->fd==-1)
+            continue;
+        if(w->state==C_HELLO)
+            greet(i);
+        else if(w->state==C_STALE)
+        {
+            int got = 0;
+            if(w->sending && write_job(i)==-1)
+                got = -1;
+            else if(!w->sending)
+                got = read_message(i,sizeof(struct remote_result));
+            if(got==-1)
+                drop(i);
+            else if(got==1)
+                w->state = C_IDLE;
+        }
+    }
+}
+
+// Whether slot i has a worker that can take a candidate now. The first call
+// opens the listening socket.
+int remote_ready(int i)
+{
+    if(listen_fd==-1)
+        start_listening();
+    return conns[i].fd!=-1 && conns[i].state==C_IDLE;
+}
+
+// Fills in what remote_service() waits for: the listening socket, the
+// hellos, and the workers busy with a cancelled candidate. Returns how many.
+int remote_poll_fds(struct pollfd * fds)
+{
+    int n = 0;
+    fds[n].fd = listen_fd;
+    fds[n++].events = POLLIN;
+    for(int i=0;i<jobs;i++)
+    {
+        struct conn * w = &conns[i];
+        if(w->fd==-1 || (w->state!=C_HELLO && w->state!=C_STALE))
+            continue;
+        fds[n].fd = w->fd;
+        fds[n++].events = w->state==C_STALE && w->sending ? POLLOUT : POLLIN;
+    }
+    return n;
+}
+
+// Milliseconds until the next silent worker is to be dropped, -1 for none
+int remote_poll_timeout(void)
+{
+    long now = now_ms();
+    long wait = -1;
+    for(int i=0;i<jobs;i++)
+    {
+        if(conns[i].fd==-1 || conns[i].state!=C_HELLO)
+            continue;
+        long left = conns[i].hello_by>now ? conns[i].hello_by-now : 0;
+        if(wait==-1 || left<wait)
+            wait = left;
+    }
+    return wait;
+}
+
+// Blocks until a worker may be free, when nothing else is running
+void remote_wait(void)
+{
+    struct pollfd fds[MAX_JOBS+1];
+    int workers = 0;
+    for(int i=0;i<jobs;i++)
+        workers += conns[i].fd!=-1 && conns[i].state!=C_HELLO;
+    if(workers==0)
+        fprintf(stderr,"Waiting for workers on %s\n",remote_addr);
+    if(poll(fds,remote_poll_fds(fds),remote_poll_timeout())==-1 && errno!=EINTR)
+        error_handler("Poll");
+    remote_service();
+}
+
+// Starts sending candidate c to slot i's worker. Returns the socket to poll
+// for writing while the rest of it is to go, else -1. c must stay as it is
+// until then, also if the candidate is cancelled.
+int remote_run(int i, const struct candidate * c)
+{
+    struct conn * w = &conns[i];
+    struct remote_job job = { stack_reference, c->len, timeout_ms, 0 };
+    w->state = C_BUSY;
+    w->job = job;
+    w->job_sent = 0;
+    w->c = c;
+    w->span = 0;
+    w->off = 0;
+    w->sending = 1;
+    w->in_len = 0;
+    return remote_feed(i);
+}
+
+// Sends more of slot i's candidate; returns as remote_run(). A failed send
+// shows up when the result is read.
+int remote_feed(int i)
+{
+    return write_job(i)==0 ? conns[i].fd : -1;
+}
+
+// Readable once slot i's worker has answered or gone away
+int remote_fd(int i)
+{
+    return conns[i].fd;
+}
+
+// The verdict of slot i's candidate: 0 or 1, -1 while the rest of the
+// result is still to come, -2 if the worker went away with the candidate
+int remote_result(int i)
+{
+    struct remote_result r;
+    int got = read_message(i,sizeof(r));
+    if(got==0)
+        return -1;
+    if(got==-1)
+    {
+        drop(i);
+        return -2;
+    }
+    memcpy(&r,conns[i].in,sizeof(r));
+    conns[i].state = C_IDLE;
+    timeout_count += r.timeouts;
+    limit_count += r.limits;
+    if(r.run_ms>=0)
+    {
+        target_ms += r.run_ms;
+        target_runs++;
+    }
+    if(stack_reference==0)
+        stack_reference = r.stack_reference;
+    return r.verdict;
+}
+
+// Slot i's candidate is no longer wanted
+void remote_cancel(int i)
+{
+    if(conns[i].fd!=-1)
+        conns[i].state = C_STALE;
+}
+
+// Slot i's worker has not answered long after the time limit it enforces
+// itself, and is taken for stuck
+void remote_drop(int i)
+{
+    if(conns[i].fd!=-1)
+        drop(i);
+}
+
+static void make_job(int i, void * ctx, struct candidate * out)
+{
+    (void)i;
+    (void)ctx;
+    cand_whole(out);
+}
+
+// --worker: connects to the coordinator at addr, then runs candidates until
+// it goes away
+void run_worker(const char * addr)
+{
+    struct sockaddr_storage sa;
+    socklen_t len;
+    int family = parse_addr(addr,&sa,&len);
+    int fd = -1;
+    int one = 1;
+
+    for(int tries=0;;tries++)
+    {
+        fd = socket(family,SOCK_STREAM|SOCK_CLOEXEC,0);
+        if(fd==-1)
+            error_handler("Worker socket");
+        if(connect(fd,(struct sockaddr *)&sa,len)==0)
+            break;
+        close(fd);
+        if(tries==CONNECT_TRIES)
+            error_handler("Cannot reach the coordinator");
+        usleep(CONNECT_PAUSE_US);
+    }
+    setsockopt(fd,IPPROTO_TCP,TCP_NODELAY,&one,sizeof(one));
+
+    struct remote_hello hello = { REMOTE_MAGIC, REMOTE_VERSION };
+    struct remote_config config;
+    if(full_io(fd,&hello,sizeof(hello),1)==-1 || full_io(fd,&config,sizeof(config),0)==-1)
+        error_handler("The coordinator turned the worker away");
+    oracle_signal = config.signal;
+    oracle_exit = config.exit;
+    stack_frames = config.stack_frames;
+    if(config.msg_len>=0)
+    {
+        error_msg = calloc(config.msg_len+1,1);
+        if(error_msg==NULL || full_io(fd,error_msg,config.msg_len,0)==-1)
+            error_handler("Reading the worker configuration");
+    }
+
+    char * buf = NULL;
+    for(;;)
+    {
+        struct remote_job job;
+        if(full_io(fd,&job,sizeof(job),0)==-1)
+            exit(0);
+        buf = realloc(buf,job.len ? job.len : 1);
+        if(buf==NULL)
+            error_handler("Allocating a candidate");
+        if(full_io(fd,buf,job.len,0)==-1)
+            exit(0);
+
+        // The candidate becomes the "original" the worker's batch of one
+        // is cut from
+        original.data = buf;
+        original.len = job.len;
+        stack_reference = job.stack_reference;
+        timeout_ms = job.timeout_ms;
+        int timeouts = timeout_count;
+        int limits = limit_count;
+        long ms = target_ms;
+        int runs = target_runs;
+        struct remote_result r;
+        r.verdict = run_batch(1,make_job,NULL)==0;
+        r.timeouts = timeout_count-timeouts;
+        r.limits = limit_count-limits;
+        r.run_ms = target_runs>runs ? target_ms-ms : -1;
+        r.stack_reference = stack_reference;
+        if(full_io(fd,&r,sizeof(r),1)==-1)
+            exit(0);
+    }
+}
@@ -0,0 +1,1010 @@
+//21800637 Jooyoung Jang 
+//21600415 Sehyuk Yang
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <errno.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <libgen.h>
+#include <limits.h>
+#include <spawn.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include "cimin.h"
+
+// One candidate execution in flight
+struct slot {
+    pid_t pid;
+    int idx;
+    struct cache_key key;
+    struct candidate input;
+    int in_span;
+    size_t in_off;
+    int in_fd;
+    int err_fd;
+    int pid_fd;
+    long start;
+    long deadline;
+    size_t matched;
+    int hit;            // -m was seen
+    int status;         // wait status once reaped
+    char * report;      // the end of stderr, for --stack
+    size_t report_len;
+    size_t report_cap;
+};
+
+static struct slot slots[MAX_JOBS];
+static int running = 0;
+
+// Without -m or --stack nobody reads the target's stderr, and it goes to
+// /dev/null instead of a pipe; the exit then comes from the pidfd
+static int capture_stderr = 1;
+static int null_fd = -1;
+// With -m as the only oracle the message decides, and the target is killed
+// as soon as it shows up
+static int message_only;
+
+// --listen: how long after the time limit a worker that has not answered
+// is taken for stuck
+#define REMOTE_GRACE_MS 10000
+
+// Run time of the candidates that finished on their own, for the stats
+long target_ms = 0;
+int target_runs = 0;
+
+// -x forksrv: one fork server per slot, reached through a control socket
+static pid_t server_pid[MAX_JOBS];
+static int server_ctl[MAX_JOBS];
+
+// @@ in the target's arguments: every slot writes its candidates to a file
+// of its own, a memfd the target opens as /proc/self/fd/N or else a file in
+// /dev/shm, and the arguments name that file instead of @@. stdin is empty.
+static int file_input = -1;
+static int slot_file[MAX_JOBS];
+static char * slot_path[MAX_JOBS];
+static char ** slot_argv[MAX_JOBS];
+static pid_t file_owner;
+
+// The argument list a slot's target gets
+static char ** target_argv(int i)
+{
+    return file_input ? slot_argv[i] : additional_args;
+}
+
+static void exec_target(char ** argv)
+{
+    if(argv[1]!=NULL)
+    {
+        if(execv(target_program,argv)==-1)
+            error_handler("Execv");
+    }
+    else{
+        if(execl(target_program,target_program,NULL)==-1)
+            error_handler("Execlp");
+    }
+}
+
+// -x spawn: posix_spawn lets glibc start the target with
+// clone(CLONE_VM|CLONE_VFORK), so nothing of cimin's address space is copied
+// and the parent only waits for the exec. The attributes are the same for
+// every candidate and are set up once. posix_spawn has no rlimit attribute,
+// and the target would run for a while before a prlimit() reached it, so
+// targets with --mem, --cpu or --fsize are forked instead (see run_batch());
+// the core dump limit the target inherits from cimin.
+static pid_t spawn_target(int in_fd, int err_fd, char ** argv)
+{
+    static posix_spawnattr_t attr;
+    static int attr_ready = 0;
+    posix_spawn_file_actions_t actions;
+    pid_t pid;
+
+    if(!attr_ready)
+    {
+        // cimin ignores SIGPIPE; the target gets the default back
+        sigset_t def;
+        sigemptyset(&def);
+        sigaddset(&def,SIGPIPE);
+        posix_spawnattr_init(&attr);
+        posix_spawnattr_setsigdefault(&attr,&def);
+        posix_spawnattr_setflags(&attr,POSIX_SPAWN_SETSIGDEF);
+        apply_limits(0,0);
+        attr_ready = 1;
+    }
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions,in_fd,STDIN_FILENO);
+    posix_spawn_file_actions_adddup2(&actions,err_fd,STDERR_FILENO);
+    int err = posix_spawn(&pid,target_program,&actions,&attr,argv,environ);
+    posix_spawn_file_actions_destroy(&actions);
+    if(err!=0)
+    {
+        errno = err;
+        error_handler("Spawn");
+    }
+    return pid;
+}
+
+// forksrv.so is expected next to the cimin binary unless CIMIN_FORKSRV says
+// otherwise
+static void preload_forksrv(void)
+{
+    char exe[PATH_MAX];
+    char lib[PATH_MAX + 16];
+    char * path = getenv("CIMIN_FORKSRV");
+
+    if(path==NULL)
+    {
+        ssize_t len = readlink("/proc/self/exe",exe,sizeof(exe)-1);
+        if(len==-1)
+            error_handler("Locating forksrv.so");
+        exe[len] = '\0';
+        snprintf(lib,sizeof(lib),"%s/forksrv.so",dirname(exe));
+        path = lib;
+    }
+    if(access(path,R_OK)==-1)
+        error_handler("forksrv.so not found (build it with make or set CIMIN_FORKSRV)");
+
+    char * preload = getenv("LD_PRELOAD");
+    if(preload!=NULL)
+    {
+        char * both = malloc(strlen(path)+strlen(preload)+2);
+        sprintf(both,"%s:%s",path,preload);
+        path = both;
+    }
+    setenv("LD_PRELOAD",path,1);
+    // ASan insists on being first in the library list
+    setenv("ASAN_OPTIONS","verify_asan_link_order=0",0);
+}
+
+// Starts the target once under forksrv.so; it stops in front of main() and
+// forks a fresh copy for every candidate sent over the control socket
+static void start_server(int i)
+{
+    int sv[2];
+    if(socketpair(AF_UNIX,SOCK_STREAM|SOCK_CLOEXEC,0,sv)==-1)
+    {
+        error_handler("Fork server socket");
+    }
+
+    pid_t pid = fork();
+    if(pid==0)
+    {
+        char fd[16];
+        int null_fd = open("/dev/null",O_RDWR);
+        dup2(null_fd,STDIN_FILENO);
+        dup2(null_fd,STDERR_FILENO);
+        snprintf(fd,sizeof(fd),"%d",dup(sv[1]));
+        setenv("CIMIN_FORKSRV_FD",fd,1);
+        // The server would use up a CPU limit of its own over all the forks,
+        // so forksrv.so sets that one in each forked child
+        apply_limits(0,0);
+        if(limit_cpu_s>0)
+        {
+            snprintf(fd,sizeof(fd),"%d",limit_cpu_s);
+            setenv("CIMIN_CPU_LIMIT",fd,1);
+        }
+        preload_forksrv();
+        exec_target(target_argv(i));
+    }
+    else if(pid==-1)
+    {
+        error_handler("Fork");
+    }
+    close(sv[1]);
+    server_pid[i] = pid;
+    server_ctl[i] = sv[0];
+}
+
+static void send_fds(int ctl, int in_fd, int err_fd)
+{
+    char byte = 0;
+    struct iovec iov = { &byte, 1 };
+    char control[CMSG_SPACE(2 * sizeof(int))];
+    struct msghdr msg;
+
+    memset(&msg,0,sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    struct cmsghdr * cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(2 * sizeof(int));
+    memcpy(CMSG_DATA(cmsg),(int[]){ in_fd, err_fd },2 * sizeof(int));
+
+    if(sendmsg(ctl,&msg,0)!=1)
+        error_handler("Fork server is gone (is the target dynamically linked?)");
+}
+
+static void read_server(int ctl, void * buf, size_t len)
+{
+    if(read(ctl,buf,len)!=(ssize_t)len)
+        error_handler("Fork server is gone (is the target dynamically linked?)");
+}
+
+static long now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return ts.tv_sec*1000L + ts.tv_nsec/1000000;
+}
+
+// A pidfd turns readable when the child exits, which tells the event loop
+// about the exit even when something else still holds the stderr pipe open.
+// -1 on kernels and headers without pidfd_open.
+static int open_pidfd(pid_t pid)
+{
+    #ifdef SYS_pidfd_open
+    return syscall(SYS_pidfd_open,pid,0);
+    #else
+    return -1;
+    #endif
+}
+
+// Readable once the slot's child has exited: its pidfd, or the fork server's
+// control socket, on which the wait status arrives
+static int done_fd(struct slot * sl)
+{
+    if(exec_mode==EXEC_FORKSRV)
+        return server_ctl[sl-slots];
+    if(exec_mode==EXEC_PERSIST)
+        return persist_fd(sl-slots);
+    if(exec_mode==EXEC_REMOTE)
+        return remote_fd(sl-slots);
+    return sl->pid_fd;
+}
+
+static void remove_files(void)
+{
+    // Children that fail to exec exit through here as well
+    if(getpid()!=file_owner)
+        return;
+    for(int i=0;i<jobs;i++)
+    {
+        if(slot_path[i]!=NULL && strncmp(slot_path[i],"/proc/",6)!=0)
+            unlink(slot_path[i]);
+    }
+}
+
+// arg with every @@ replaced by path
+static char * substitute(const char * arg, const char * path)
+{
+    size_t count = 0;
+    for(const char * at = strstr(arg,"@@"); at!=NULL; at = strstr(at+2,"@@"))
+        count++;
+    char * out = malloc(strlen(arg)+count*strlen(path)+1);
+    char * o = out;
+    for(const char * at; (at = strstr(arg,"@@"))!=NULL; arg = at+2)
+    {
+        memcpy(o,arg,at-arg);
+        o += at-arg;
+        o = stpcpy(o,path);
+    }
+    strcpy(o,arg);
+    return out;
+}
+
+// Creates the slots' input files if the arguments ask for them. The memfds
+// are inherited on purpose, also by fork servers, since the target opens
+// them through its own /proc/self/fd.
+static void setup_files(void)
+{
+    int argc = 0;
+    file_input = 0;
+    // A library target gets the candidate's bytes as they are, and a remote
+    // one has its worker's arguments
+    if(exec_mode==EXEC_PERSIST || exec_mode==EXEC_REMOTE)
+        return;
+    for(char ** arg = additional_args+1; *arg!=NULL; arg++, argc++)
+    {
+        if(strstr(*arg,"@@")!=NULL)
+            file_input = 1;
+    }
+    if(!file_input)
+        return;
+
+    file_owner = getpid();
+    atexit(remove_files);
+    for(int i=0;i<jobs;i++)
+    {
+        char path[64];
+        int fd = memfd_create("cimin-input",0);
+        if(fd!=-1)
+            snprintf(path,sizeof(path),"/proc/self/fd/%d",fd);
+        else
+        {
+            snprintf(path,sizeof(path),"/dev/shm/cimin-%d-%d",(int)getpid(),i);
+            if((fd = open(path,O_RDWR|O_CREAT|O_TRUNC|O_CLOEXEC,0600))==-1)
+                error_handler("Creating the input file");
+        }
+        slot_file[i] = fd;
+        slot_path[i] = strdup(path);
+        slot_argv[i] = calloc(argc+2,sizeof(char *));
+        slot_argv[i][0] = additional_args[0];
+        for(int k=1;k<=argc;k++)
+            slot_argv[i][k] = substitute(additional_args[k],path);
+    }
+}
+
+// Replaces the slot's input file with its candidate
+static void write_file(struct slot * sl)
+{
+    int fd = slot_file[sl-slots];
+    int span = 0;
+    size_t off = 0;
+    if(ftruncate(fd,0)==-1 || lseek(fd,0,SEEK_SET)==-1)
+        error_handler("Truncating the input file");
+    while(span<sl->input.count)
+    {
+        if(cand_write(fd,&sl->input,&span,&off)==-1 && errno!=EINTR)
+            error_handler("Writing the input file");
+    }
+}
+
+static void close_input(struct slot * sl)
+{
+    if(sl->in_fd!=-1)
+        close(sl->in_fd);
+    sl->in_fd = -1;
+}
+
+// Starts the target with its stdin and stderr on pipes (stderr on /dev/null
+// if it is not captured), by fork and exec,
+// posix_spawn or through the slot's fork server. The candidate in sl->input is
+// streamed into the stdin pipe from the event loop, so inputs of any size go
+// through without the pipe filling up, or written to the slot's file first
+// when the target takes it as @@. The child gets timeout_ms from now
+// before the event loop kills it.
+static void launch(struct slot * sl, int idx)
+{
+    int in_pipe[2];
+    int e_pipe[2];
+
+    sl->idx = idx;
+    sl->matched = 0;
+    sl->hit = 0;
+    sl->status = 0;
+    sl->report_len = 0;
+    sl->start = now_ms();
+    sl->deadline = timeout_ms>0 ? sl->start+timeout_ms : 0;
+    running++;
+    if(exec_mode==EXEC_PERSIST)
+    {
+        exec_count++;
+        sl->pid = persist_run(sl-slots,&sl->input,&sl->err_fd);
+        sl->in_fd = -1;
+        sl->pid_fd = -1;
+        return;
+    }
+    if(exec_mode==EXEC_REMOTE)
+    {
+        // There is no local process, and no process can have this pid. The
+        // socket is in_fd while the candidate is being sent. The worker
+        // keeps the time limit; the deadline here is for a worker that is
+        // stuck, and holds without a time limit too, since a silent worker
+        // would otherwise keep the batch waiting for good.
+        exec_count++;
+        sl->pid = INT_MAX;
+        sl->err_fd = sl->pid_fd = -1;
+        sl->in_fd = remote_run(sl-slots,&sl->input);
+        sl->deadline = sl->start+timeout_ms+REMOTE_GRACE_MS;
+        return;
+    }
+
+    if(pipe2(in_pipe,O_CLOEXEC)==-1)
+    {
+        error_handler("Inpipe open");
+    }
+    if(!capture_stderr)
+    {
+        e_pipe[0] = -1;
+        e_pipe[1] = null_fd;
+    }
+    else if(pipe2(e_pipe,O_CLOEXEC)==-1)
+    {
+        error_handler("Error pipe open");
+    }
+    exec_count++;
+    if(file_input)
+        write_file(sl);
+
+    if(exec_mode==EXEC_FORKSRV)
+    {
+        int i = sl - slots;
+        if(server_pid[i]==0)
+            start_server(i);
+        send_fds(server_ctl[i],in_pipe[0],e_pipe[1]);
+        read_server(server_ctl[i],&sl->pid,sizeof(sl->pid));
+        if(sl->pid<=0)
+            error_handler("Fork server could not fork");
+    }
+    else if(exec_mode==EXEC_SPAWN)
+    {
+        sl->pid = spawn_target(in_pipe[0],e_pipe[1],target_argv(sl-slots));
+    }
+    else
+    {
+        pid_t child_pid = fork();
+
+        if(child_pid==0)// error return , receive input
+        {
+            if(dup2(in_pipe[0],STDIN_FILENO) == -1)
+            {
+                error_handler("Redirecting pipe for STDIN");
+            }
+            if(dup2(e_pipe[1],STDERR_FILENO) == -1)
+            {
+                error_handler("Redirecting pipe for STDERR");
+            }
+            signal(SIGPIPE,SIG_DFL);
+            apply_limits(0,1);
+            exec_target(target_argv(sl-slots));
+        }
+        else if(child_pid==-1)
+        {
+            error_handler("Fork");
+        }
+        sl->pid = child_pid;
+    }
+    #ifdef DEBUG
+    printf("Candidate: %zu bytes\n",sl->input.len);
+    #endif
+
+    close(in_pipe[0]);
+    fcntl(in_pipe[1],F_SETFL,O_NONBLOCK);
+    if(capture_stderr)
+    {
+        close(e_pipe[1]);
+        fcntl(e_pipe[0],F_SETFL,O_NONBLOCK);
+    }
+
+    sl->in_span = 0;
+    sl->in_off = 0;
+    sl->in_fd = in_pipe[1];
+    sl->err_fd = e_pipe[0];
+    sl->pid_fd = exec_mode!=EXEC_FORKSRV ? open_pidfd(sl->pid) : -1;
+    if(sl->input.len==0 || file_input)
+        close_input(sl);
+}
+
+// Writes as much of the candidate as the stdin pipe (or the worker's
+// socket) takes right now
+static void feed(struct slot * sl)
+{
+    if(exec_mode==EXEC_REMOTE)
+    {
+        sl->in_fd = remote_feed(sl-slots);
+        return;
+    }
+    ssize_t len = cand_write(sl->in_fd,&sl->input,&sl->in_span,&sl->in_off);
+    if(len==-1)
+    {
+        // EPIPE: the target stopped reading, which is its business
+        if(errno!=EAGAIN && errno!=EINTR)
+            close_input(sl);
+        return;
+    }
+    if(sl->in_span==sl->input.count)
+        close_input(sl);
+}
+
+// KMP failure function of the error message, so stderr can be matched as it
+// streams in, with matches split across reads handled by the automaton state
+static size_t * failure = NULL;
+static size_t msg_len;
+
+static void build_matcher(void)
+{
+    if(error_msg==NULL)
+        return;
+    msg_len = strlen(error_msg);
+    failure = calloc(msg_len+1,sizeof(size_t));
+    for(size_t i=1,k=0;i<msg_len;i++)
+    {
+        while(k>0 && error_msg[i]!=error_msg[k])
+            k = failure[k];
+        if(error_msg[i]==error_msg[k])
+            k++;
+        failure[i+1] = k;
+    }
+}
+
+// Advances the slot's matcher over a chunk of stderr; 1 once the whole
+// message has been seen
+static int match(struct slot * sl, const char * buf, size_t len)
+{
+    size_t k = sl->matched;
+    for(size_t i=0;i<len;i++)
+    {
+        while(k>0 && buf[i]!=error_msg[k])
+            k = failure[k];
+        if(buf[i]==error_msg[k])
+            k++;
+        if(k==msg_len)
+            return 1;
+    }
+    sl->matched = k;
+    return 0;
+}
+
+static void reap(struct slot * sl)
+{
+    int status = 0;
+    // A remote candidate goes on to the end, and its result is dropped. The
+    // socket stays open for the worker's next one.
+    if(exec_mode==EXEC_REMOTE)
+    {
+        remote_cancel(sl-slots);
+        sl->in_fd = -1;
+        sl->pid = 0;
+        running--;
+        return;
+    }
+    close_input(sl);
+    if(exec_mode==EXEC_PERSIST)
+    {
+        sl->status = persist_stop(sl-slots);
+        note_limit(sl->status);
+        sl->pid = 0;
+        running--;
+        return;
+    }
+    if(sl->err_fd!=-1)
+        close(sl->err_fd);
+    if(sl->pid_fd!=-1)
+        close(sl->pid_fd);
+    if(exec_mode==EXEC_FORKSRV)
+        read_server(server_ctl[sl-slots],&status,sizeof(status));
+    else
+        waitpid(sl->pid,&status,0);
+    note_limit(status);
+    sl->status = status;
+    sl->pid = 0;
+    running--;
+    #ifdef DEBUG
+    if (WIFEXITED(status))
+        printf("Child process exited with status %d\n", WEXITSTATUS(status));
+    #endif
+}
+
+// Kills the slot's target and reaps it. A remote slot has no local process.
+static void stop(struct slot * sl)
+{
+    if(exec_mode!=EXEC_REMOTE)
+        kill(sl->pid,SIGKILL);
+    reap(sl);
+}
+
+// A candidate that finished on its own; the ones killed on a match, at
+// their deadline or as cancelled would only skew the average. A remote
+// worker reports its own run time instead.
+static void note_run(struct slot * sl)
+{
+    target_ms += now_ms()-sl->start;
+    target_runs++;
+}
+
+#define REPORT_MAX (1 << 20)
+
+// Keeps the last REPORT_MAX bytes of the slot's stderr; sanitizer reports
+// come at the end, after whatever the target printed before
+static void keep_report(struct slot * sl, const char * buf, size_t len)
+{
+    if(sl->report_len+len>REPORT_MAX)
+    {
+        memmove(sl->report,sl->report+sl->report_len-REPORT_MAX/2,REPORT_MAX/2);
+        sl->report_len = REPORT_MAX/2;
+    }
+    if(sl->report_len+len>sl->report_cap)
+    {
+        sl->report_cap = sl->report_cap ? 2*sl->report_cap : 65536;
+        if(sl->report_cap>REPORT_MAX)
+            sl->report_cap = REPORT_MAX;
+        sl->report = realloc(sl->report,sl->report_cap);
+        if(sl->report==NULL)
+            error_handler("Growing a report buffer");
+    }
+    memcpy(sl->report+sl->report_len,buf,len);
+    sl->report_len += len;
+}
+
+// Hands a chunk of stderr to the oracles that read it
+static void take_stderr(struct slot * sl, const char * buf, size_t len)
+{
+    if(error_msg!=NULL && !sl->hit)
+        sl->hit = match(sl,buf,len);
+    if(stack_frames>0)
+        keep_report(sl,buf,len);
+}
+
+// The verdict on a finished candidate: the wait status first, then -m, and
+// the stack only if everything else agrees
+static int decide(struct slot * sl)
+{
+    if(!oracle_status(sl->status) || (error_msg!=NULL && !sl->hit))
+        return 0;
+    return stack_frames==0 || oracle_stack(sl->report,sl->report_len);
+}
+
+// Reads what the child wrote to stderr. With -m as the only oracle, as soon
+// as the error message shows up the child is killed and reaped and 1 is
+// returned. EOF only closes the pipe, the exit itself is picked up from
+// done_fd(); without one the child is reaped and decided on. Returns -1
+// while undecided.
+static int collect(struct slot * sl)
+{
+    char buf[BUFSIZE];
+    ssize_t len = read(sl->err_fd,buf,sizeof(buf));
+    if(len==-1)
+    {
+        if(errno==EINTR || errno==EAGAIN)
+            return -1;
+        error_handler("Reading From pipe");
+    }
+    #ifdef DEBUG
+    printf("Error content: %.*s\n",(int)len,buf);
+    #endif
+    if(len>0)
+    {
+        take_stderr(sl,buf,len);
+        if(!sl->hit || !message_only)
+            return -1;
+        stop(sl);
+        return 1;
+    }
+
+    // A persistent worker's stderr is closed with the worker
+    if(exec_mode!=EXEC_PERSIST)
+        close(sl->err_fd);
+    sl->err_fd = -1;
+    if(done_fd(sl)!=-1)
+        return -1;
+    reap(sl);
+    note_run(sl);
+    return decide(sl);
+}
+
+// Candidates of the batch whose remote worker went away before answering
+static int retry[MAX_JOBS];
+static int retries = 0;
+
+// The child has exited: what it left in the stderr pipe decides, and a
+// writer that outlived it is not waited for
+static int exited(struct slot * sl)
+{
+    char buf[BUFSIZE];
+    ssize_t len;
+    // A persistent worker answers only after the candidate's stderr is
+    // written, and that stderr has to be drained for the next candidate
+    int alive = exec_mode==EXEC_PERSIST && persist_done(sl-slots);
+    while(sl->err_fd!=-1 && (len = read(sl->err_fd,buf,sizeof(buf)))>0)
+        take_stderr(sl,buf,len);
+    // A remote worker has answered, or gone away with the candidate, which
+    // then runs again
+    if(exec_mode==EXEC_REMOTE)
+    {
+        int verdict = remote_result(sl-slots);
+        if(verdict==-1)
+            return -1;
+        sl->in_fd = -1;
+        sl->pid = 0;
+        running--;
+        if(verdict==-2)
+        {
+            retry[retries++] = sl->idx;
+            return -1;
+        }
+        return verdict;
+    }
+    // A worker that lives on has returned from the entry point. One that
+    // has done its share is retired only after that, so that the SIGKILL
+    // it gets is not taken for the candidate's status.
+    if(alive)
+    {
+        sl->status = 0;
+        sl->pid = 0;
+        running--;
+        if(alive==2)
+            persist_stop(sl-slots);
+        note_run(sl);
+        return decide(sl);
+    }
+    reap(sl);
+    note_run(sl);
+    return decide(sl);
+}
+
+static void setup_oracles(void)
+{
+    build_matcher();
+    message_only = error_msg!=NULL && oracle_signal==0 && oracle_exit==-1 && stack_frames==0;
+    // Fork servers and workers report exits on their own sockets; the others
+    // need a pidfd to do without the stderr pipe
+    int pid_fd = open_pidfd(getpid());
+    if(pid_fd!=-1)
+        close(pid_fd);
+    if(error_msg!=NULL || stack_frames>0 || exec_mode==EXEC_PERSIST
+       || (exec_mode!=EXEC_FORKSRV && pid_fd==-1))
+        return;
+    capture_stderr = 0;
+    if((null_fd = open("/dev/null",O_WRONLY|O_CLOEXEC))==-1)
+        error_handler("Opening /dev/null");
+}
+
+// In batch mode the -j budget is shared with the other minimizations through
+// the jobserver pipe named in CIMIN_JOBSERVER: one child is always allowed,
+// every further one holds a token from the pipe until it is done. The number
+// of tokens held is kept up to date at this process's place in the batch's
+// held file, so that the batch can put them back if this process is killed;
+// on exit they are handed back here.
+static int js_read = -1;
+static int js_write = -1;
+static int js_held = -1;
+static int js_index;
+static pid_t js_owner;
+static int tokens = 0;
+
+static void note_held(void)
+{
+    if(js_held!=-1)
+        pwrite(js_held,&tokens,sizeof(tokens),js_index*sizeof(tokens));
+}
+
+static void return_jobs(void)
+{
+    if(getpid()!=js_owner)
+        return;
+    while(tokens>0 && write(js_write,"+",1)==1)
+        tokens--;
+    note_held();
+}
+
+static void setup_jobserver(void)
+{
+    char * fds = getenv("CIMIN_JOBSERVER");
+    if(fds==NULL || sscanf(fds,"%d,%d,%d,%d",&js_read,&js_write,&js_held,&js_index)<2)
+    {
+        js_read = js_write = js_held = -1;
+        return;
+    }
+    // Targets and fork servers have no use for them
+    fcntl(js_read,F_SETFD,FD_CLOEXEC);
+    fcntl(js_write,F_SETFD,FD_CLOEXEC);
+    if(js_held!=-1)
+        fcntl(js_held,F_SETFD,FD_CLOEXEC);
+    js_owner = getpid();
+    atexit(return_jobs);
+}
+
+// 1 if one more child may start now
+static int take_job(void)
+{
+    char token;
+    if(js_read==-1 || running<1+tokens)
+        return 1;
+    if(read(js_read,&token,1)!=1)
+        return 0;
+    tokens++;
+    note_held();
+    return 1;
+}
+
+// Hands back the tokens that running children no longer need
+static void release_jobs(void)
+{
+    while(tokens>0 && tokens>running-1)
+    {
+        if(write(js_write,"+",1)!=1)
+            break;
+        tokens--;
+    }
+    note_held();
+}
+
+// A slot that can take a candidate now, -1 if there is none. A remote slot
+// also needs a worker that is free.
+static int free_slot(void)
+{
+    for(int i=0;i<jobs;i++)
+    {
+        if(slots[i].pid==0 && (exec_mode!=EXEC_REMOTE || remote_ready(i)))
+            return i;
+    }
+    return -1;
+}
+
+// Once candidate k reproduces, nothing after it in the batch can change the
+// answer: those still running are killed and, since their outcome is
+// unknown, not cached
+static void cancel_after(int found)
+{
+    for(int i=0;i<jobs;i++)
+    {
+        if(slots[i].pid==0 || slots[i].idx<=found)
+            continue;
+        stop(&slots[i]);
+        cancel_count++;
+    }
+}
+
+// Runs candidates 0..n-1 of a batch with up to `jobs` of them in flight and
+// returns the lowest index that reproduces the crash, or -1. Candidates whose
+// outcome is already in the cache are not run again. Candidates are
+// dispatched in index order and a hit at index k stops further dispatching
+// and cancels the candidates after k that are still running; the batch only
+// returns once every candidate below k has finished, so the answer is the
+// same for any number of jobs. A candidate still running after
+// timeout_ms is killed and counts as not reproducing the crash.
+int run_batch(int n, candidate_fn make, void * ctx)
+{
+    int next = 0;
+    int found = -1;
+
+    if(file_input==-1)
+    {
+        if(exec_mode==EXEC_SPAWN && (limit_mem_mb>0 || limit_cpu_s>0 || limit_fsize_mb>0))
+            exec_mode = EXEC_FORK;
+        setup_oracles();
+        setup_files();
+        setup_jobserver();
+    }
+    struct pollfd fds[4*MAX_JOBS+2];
+
+    retries = 0;
+    while(running > 0 || retries > 0 || (next < n && found == -1))
+    {
+        if(interrupted)
+            stop_interrupted();
+        int i;
+        while((retries > 0 || (next < n && found == -1)) && (i = free_slot()) != -1 && take_job())
+        {
+            // A lost candidate before the hit still decides the answer
+            int idx = retries > 0 ? retry[--retries] : next++;
+            if(found!=-1 && idx>found)
+                continue;
+            make(idx,ctx,&slots[i].input);
+            struct cache_key key = cache_hash(&slots[i].input);
+            int verdict = cache_lookup(&key);
+            if(verdict==-1)
+            {
+                launch(&slots[i],idx);
+                slots[i].key = key;
+            }
+            else if(verdict==1 && (found==-1 || idx<found))
+                found = idx;
+        }
+
+        release_jobs();
+        if(running==0)
+        {
+            // Nothing to run the rest on until a worker turns up
+            if(exec_mode==EXEC_REMOTE && (retries > 0 || (next < n && found == -1)))
+                remote_wait();
+            // Otherwise everything dispatched so far came from the cache
+            continue;
+        }
+
+        int nfds = 0;
+        int which[4*MAX_JOBS+2];
+        int wait = -1;
+        long now = now_ms();
+        for(int i=0;i<jobs;i++)
+        {
+            struct slot * sl = &slots[i];
+            if(sl->pid==0)
+                continue;
+            int fd[3] = { sl->err_fd, sl->in_fd, done_fd(sl) };
+            for(int k=0;k<3;k++)
+            {
+                if(fd[k]==-1)
+                    continue;
+                fds[nfds].fd = fd[k];
+                fds[nfds].events = k==1 ? POLLOUT : POLLIN;
+                which[nfds++] = i;
+            }
+            if(sl->deadline!=0)
+            {
+                long left = sl->deadline>now ? sl->deadline-now : 0;
+                if(wait==-1 || left<wait)
+                    wait = left;
+            }
+        }
+        // Waiting for a token as well, if that is all that holds us back
+        if(js_read!=-1 && running<jobs && next<n && found==-1)
+        {
+            fds[nfds].fd = js_read;
+            fds[nfds].events = POLLIN;
+            which[nfds++] = -1;
+        }
+        // And for what remote_service() looks after: workers that connect,
+        // and workers that finish a cancelled candidate
+        if(exec_mode==EXEC_REMOTE)
+        {
+            int k = remote_poll_fds(&fds[nfds]);
+            while(k-->0)
+                which[nfds++] = -1;
+            int hello = remote_poll_timeout();
+            if(hello!=-1 && (wait==-1 || hello<wait))
+                wait = hello;
+        }
+        if(poll(fds,nfds,wait)==-1)
+        {
+            if(errno==EINTR)
+                continue;
+            error_handler("Poll");
+        }
+        if(exec_mode==EXEC_REMOTE)
+            remote_service();
+        for(int i=0;i<nfds;i++)
+        {
+            if(which[i]==-1)
+                continue;
+            struct slot * sl = &slots[which[i]];
+            // An earlier entry may have finished this slot already
+            if(fds[i].revents==0 || sl->pid==0)
+                continue;
+            int verdict;
+            // A worker's socket is both in_fd and done_fd
+            if(fds[i].fd==sl->in_fd && fds[i].events==POLLOUT)
+            {
+                feed(sl);
+                continue;
+            }
+            else if(fds[i].fd==sl->err_fd)
+                verdict = collect(sl);
+            else if(fds[i].fd==done_fd(sl))
+                verdict = exited(sl);
+            else
+                continue;
+            if(verdict==-1)
+                continue;
+            cache_insert(&sl->key,verdict);
+            if(verdict==1 && (found==-1 || sl->idx<found))
+                found = sl->idx;
+        }
+
+        now = now_ms();
+        for(int i=0;i<jobs;i++)
+        {
+            struct slot * sl = &slots[i];
+            if(sl->pid==0 || sl->deadline==0 || now<sl->deadline)
+                continue;
+            // A stuck worker is let go, and another one gets its candidate
+            if(exec_mode==EXEC_REMOTE)
+            {
+                remote_drop(i);
+                sl->in_fd = -1;
+                sl->pid = 0;
+                running--;
+                retry[retries++] = sl->idx;
+                continue;
+            }
+            stop(sl);
+            timeout_count++;
+            cache_insert(&sl->key,0);
+        }
+        if(found!=-1)
+            cancel_after(found);
+        release_jobs();
+        show_progress();
+    }
+    return found;
+}
+
+void kill_children(void)
+{
+    if(exec_mode==EXEC_REMOTE)
+        return;
+    for(int i=0;i<MAX_JOBS;i++)
+    {
+        if(slots[i].pid!=0)
+            kill(slots[i].pid,SIGKILL);
+    }
+}
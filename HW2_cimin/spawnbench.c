@@ -0,0 +1,107 @@
+//21800637 Jooyoung Jang 
+//21600415 Sehyuk Yang
+//
+// Spawns per second of cimin's two ways of starting a target: fork + dup2 +
+// exec, and posix_spawn with dup2 file actions. Each run gets a stdin and a
+// stderr pipe like a cimin candidate does. Optionally the parent first
+// touches MB megabytes of heap, to show what fork pays for a bigger parent.
+//
+//   ./spawnbench [runs] [MB] [target]      (defaults: 2000 0 /bin/true)
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <spawn.h>
+#include <time.h>
+#include <sys/wait.h>
+
+static char * target;
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return ts.tv_sec + ts.tv_nsec/1e9;
+}
+
+static pid_t run_fork(int in_fd, int err_fd)
+{
+    pid_t pid = fork();
+    if(pid==0)
+    {
+        dup2(in_fd,STDIN_FILENO);
+        dup2(err_fd,STDERR_FILENO);
+        execl(target,target,NULL);
+        _exit(127);
+    }
+    return pid;
+}
+
+static pid_t run_spawn(int in_fd, int err_fd)
+{
+    posix_spawn_file_actions_t actions;
+    char * argv[] = { target, NULL };
+    pid_t pid;
+
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions,in_fd,STDIN_FILENO);
+    posix_spawn_file_actions_adddup2(&actions,err_fd,STDERR_FILENO);
+    if(posix_spawn(&pid,target,&actions,NULL,argv,environ)!=0)
+        pid = -1;
+    posix_spawn_file_actions_destroy(&actions);
+    return pid;
+}
+
+static void bench(const char * name, pid_t (*start)(int, int), int runs)
+{
+    double t = now();
+    for(int i=0;i<runs;i++)
+    {
+        int in_pipe[2], e_pipe[2];
+        if(pipe2(in_pipe,O_CLOEXEC)==-1 || pipe2(e_pipe,O_CLOEXEC)==-1)
+        {
+            perror("pipe");
+            exit(EXIT_FAILURE);
+        }
+        pid_t pid = start(in_pipe[0],e_pipe[1]);
+        if(pid==-1)
+        {
+            perror(name);
+            exit(EXIT_FAILURE);
+        }
+        close(in_pipe[0]);
+        close(e_pipe[1]);
+        close(in_pipe[1]);
+        char buf[256];
+        while(read(e_pipe[0],buf,sizeof(buf))>0)
+            ;
+        close(e_pipe[0]);
+        waitpid(pid,NULL,0);
+    }
+    t = now()-t;
+    printf("%-6s %6d runs  %8.0f spawns/s  %6.1f us each\n",name,runs,runs/t,t*1e6/runs);
+}
+
+int main(int argc, char * argv[])
+{
+    int runs = argc>1 ? atoi(argv[1]) : 2000;
+    size_t mb = argc>2 ? atoi(argv[2]) : 0;
+    target = argc>3 ? argv[3] : "/bin/true";
+
+    if(mb>0)
+    {
+        char * heap = malloc(mb<<20);
+        if(heap==NULL)
+        {
+            perror("malloc");
+            return EXIT_FAILURE;
+        }
+        memset(heap,1,mb<<20);
+    }
+    printf("target %s, parent heap %zu MB\n",target,mb);
+    bench("fork",run_fork,runs);
+    bench("spawn",run_spawn,runs);
+    return 0;
+}
@@ -0,0 +1,95 @@
+//21800637 Jooyoung Jang 
+//21600415 Sehyuk Yang
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "cimin.h"
+
+// Progress lines on stderr while the reduction runs (--progress), and the
+// final numbers as a JSON object (--stats) for scripts that compare
+// strategies or look for slow targets
+
+int progress_seconds = 0;
+
+static const char * exec_names[] = { "fork", "spawn", "forksrv", "persist", "remote" };
+static double begun;
+static double last_shown;
+static int begun_execs;
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return ts.tv_sec + ts.tv_nsec/1e9;
+}
+
+static double hit_rate(void)
+{
+    int lookups = cache_hits+cache_misses;
+    return lookups ? (double)cache_hits/lookups : 0;
+}
+
+static double target_avg_ms(void)
+{
+    return target_runs ? (double)target_ms/target_runs : 0;
+}
+
+// Marks the start of the reduction; rates count from here, so that after
+// --resume they cover this run only
+void stats_begin(void)
+{
+    begun = last_shown = now();
+    begun_execs = exec_count;
+}
+
+// Prints a progress line if the last one is progress_seconds old
+void show_progress(void)
+{
+    double t = now();
+    if(progress_seconds<=0 || t-last_shown<progress_seconds)
+        return;
+    last_shown = t;
+    fprintf(stderr,"[%.0f s] %d execs (%.1f/s), size %zu/%zu (%.1f%% removed), cache %.0f%% hits, %d timeouts, %d limits, target %.1f ms avg\n",
+            t-begun,exec_count,(exec_count-begun_execs)/(t-begun),reduced_result.len,original.len,
+            100.0*(original.len-reduced_result.len)/original.len,100*hit_rate(),timeout_count,limit_count,target_avg_ms());
+}
+
+static void json_string(FILE * fp, const char * s)
+{
+    fputc('"',fp);
+    for(;*s;s++)
+    {
+        if(*s=='"' || *s=='\\')
+            fprintf(fp,"\\%c",*s);
+        else if((unsigned char)*s<0x20)
+            fprintf(fp,"\\u%04x",*s);
+        else
+            fputc(*s,fp);
+    }
+    fputc('"',fp);
+}
+
+void write_stats(const char * path, const char * input, const char * output, double wall, double cpu)
+{
+    FILE * fp = fopen(path,"w");
+    if(fp==NULL)
+        error_handler("Writing the stats file");
+    fprintf(fp,"{\n  \"input\": ");
+    json_string(fp,input);
+    fprintf(fp,",\n  \"output\": ");
+    json_string(fp,output);
+    fprintf(fp,",\n  \"strategy\": ");
+    json_string(fp,strategy_name);
+    fprintf(fp,",\n  \"exec_mode\": \"%s\",\n  \"jobs\": %d,\n",exec_names[exec_mode],jobs);
+    fprintf(fp,"  \"original_bytes\": %zu,\n  \"result_bytes\": %zu,\n  \"removed\": %.4f,\n",
+            original.len,reduced_result.len,(double)(original.len-reduced_result.len)/original.len);
+    fprintf(fp,"  \"executions\": %d,\n  \"cancelled\": %d,\n  \"timeouts\": %d,\n  \"timeout_ms\": %d,\n",
+            exec_count,cancel_count,timeout_count,timeout_ms);
+    fprintf(fp,"  \"limit_terminations\": %d,\n",limit_count);
+    fprintf(fp,"  \"cache_hits\": %d,\n  \"cache_misses\": %d,\n  \"cache_hit_rate\": %.4f,\n",
+            cache_hits,cache_misses,hit_rate());
+    fprintf(fp,"  \"wall_seconds\": %.3f,\n  \"executions_per_second\": %.1f,\n",
+            wall,wall>0 ? (exec_count-begun_execs)/wall : 0);
+    fprintf(fp,"  \"target_ms_avg\": %.2f,\n  \"cimin_cpu_seconds\": %.3f\n}\n",target_avg_ms(),cpu);
+    fclose(fp);
+}
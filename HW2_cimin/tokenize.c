@@ -0,0 +1,69 @@
+//21800637 Jooyoung Jang 
+//21600415 Sehyuk Yang
+#include <ctype.h>
+#include <string.h>
+#include "cimin.h"
+
+// Tokenizers for -s hier. Every tokenizer has to cover the input completely,
+// so that keeping all units gives back the input byte for byte; a new one
+// only needs a split function and an entry in the table below.
+
+// A line and its newline
+static size_t split_lines(const char * data, size_t len, size_t * cuts)
+{
+    size_t n = 0;
+    cuts[n++] = 0;
+    for(size_t i=0;i<len;i++)
+    {
+        if(data[i]=='\n' && i+1<len)
+            cuts[n++] = i+1;
+    }
+    cuts[n] = len;
+    return n;
+}
+
+static int word_char(char c)
+{
+    return isalnum((unsigned char)c) || c=='_' || (c & 0x80);
+}
+
+// A run of word characters, a run of whitespace, or a single punctuation
+// character such as a bracket, quote or comma
+static size_t split_tokens(const char * data, size_t len, size_t * cuts)
+{
+    size_t n = 0;
+    for(size_t i=0;i<len;)
+    {
+        cuts[n++] = i;
+        if(word_char(data[i]))
+        {
+            while(i<len && word_char(data[i]))
+                i++;
+        }
+        else if(isspace((unsigned char)data[i]))
+        {
+            while(i<len && isspace((unsigned char)data[i]))
+                i++;
+        }
+        else
+            i++;
+    }
+    cuts[n] = len;
+    return n;
+}
+
+static const struct tokenizer tokenizers[] = {
+    { "line", split_lines },
+    { "token", split_tokens },
+    { "byte", NULL },
+};
+
+const struct tokenizer * find_tokenizer(const char * name)
+{
+    for(size_t i=0;i<sizeof(tokenizers)/sizeof(tokenizers[0]);i++)
+    {
+        if(strcmp(tokenizers[i].name,name)==0)
+            return &tokenizers[i];
+    }
+    return NULL;
+}
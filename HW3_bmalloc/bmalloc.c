@@ -1,16 +1,38 @@
 #include "bmalloc.h"
 #include <math.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/mman.h>
 #include <unistd.h>
+#ifdef BM_HARDENED
+#include <sys/random.h>
+#endif
 
 #define MIN_BLOCK_SIZE 16
 #define INIT_BLOCK_SIZE 4096
 
+#ifdef BM_HARDENED
+// Debug build: every header carries a canary derived from its address, freed
+// blocks sit poisoned in a FIFO quarantine before they can be reused, and with
+// BMALLOC_GUARD set in the environment each region is followed by an
+// inaccessible guard page. None of this exists in the release build.
+#define BM_QUARANTINE 64
+#define BM_POISON 0xdf
+#define BM_FREED_MARK 0xf5eef5eeu
+#define SET_CANARY(b) ((b)->canary = canary_of(b))
+
+static unsigned int bm_secret = 0;
+static int bm_guard = -1;
+static void *bm_quarantine[BM_QUARANTINE];
+static int bm_quarantine_next = 0;
+#else
+#define SET_CANARY(b)
+#endif
+
 bm_option bm_mode = BestFit;
-static bm_header_ptr head = NULL;
 static bm_header bm_list_head = {0, 0, 0};
 
 unsigned int exponent(int n)
@@ -26,6 +48,104 @@ unsigned int exponent(int n)
 
 unsigned int actual_block_size(int size) { return 1 << size; }
 
+// Regions are single page-aligned mmaps of INIT_BLOCK_SIZE, so the region and
+// the buddy of a block follow from its address alone.
+bm_header_ptr region_of(bm_header_ptr block)
+{
+  return (bm_header_ptr)((uintptr_t)block & ~((uintptr_t)INIT_BLOCK_SIZE - 1));
+}
+
+bm_header_ptr buddy_of(bm_header_ptr block)
+{
+  uintptr_t base = (uintptr_t)region_of(block);
+  uintptr_t offset = ((uintptr_t)block - base) ^ (1 << block->size);
+  return (bm_header_ptr)(base + offset);
+}
+
+#ifdef BM_HARDENED
+unsigned int canary_of(bm_header_ptr block)
+{
+  while (bm_secret == 0)
+  {
+    if (getrandom(&bm_secret, sizeof(bm_secret), 0) != sizeof(bm_secret))
+    {
+      bm_secret = (unsigned int)(uintptr_t)&bm_secret;
+    }
+  }
+  return (unsigned int)((uintptr_t)block >> 4) ^ bm_secret;
+}
+
+void bm_abort(char *what, char *msg, void *p)
+{
+  fprintf(stderr, "bmalloc: %s(%p): %s\n", what, p, msg);
+  abort();
+}
+
+// Validates a pointer handed back by the user before anything trusts its
+// header.
+void bm_check(void *p, char *what)
+{
+  if (((uintptr_t)p & (MIN_BLOCK_SIZE - 1)) != 0)
+  {
+    bm_abort(what, "misaligned pointer", p);
+  }
+
+  bm_header_ptr block = (bm_header_ptr)p - 1;
+  if (block->canary == (canary_of(block) ^ BM_FREED_MARK))
+  {
+    bm_abort(what, "double free of a quarantined block", p);
+  }
+  if (block->canary != canary_of(block))
+  {
+    bm_abort(what, "corrupted block header", p);
+  }
+  if (block->used == 0)
+  {
+    bm_abort(what, "double free", p);
+  }
+}
+
+// Parks a freed block, poisoned, in the quarantine and returns the block it
+// evicts (or NULL) after checking that nobody wrote to it while it was parked.
+void *quarantine(void *p)
+{
+  bm_header_ptr block = (bm_header_ptr)p - 1;
+  size_t payload_size = (1 << block->size) - sizeof(bm_header);
+  memset(p, BM_POISON, payload_size);
+  block->canary ^= BM_FREED_MARK;
+
+  void *evicted = bm_quarantine[bm_quarantine_next];
+  bm_quarantine[bm_quarantine_next] = p;
+  bm_quarantine_next = (bm_quarantine_next + 1) % BM_QUARANTINE;
+  if (evicted == NULL)
+  {
+    return NULL;
+  }
+
+  block = (bm_header_ptr)evicted - 1;
+  payload_size = (1 << block->size) - sizeof(bm_header);
+  size_t i;
+  for (i = 0; i < payload_size; i++)
+  {
+    if (((unsigned char *)evicted)[i] != BM_POISON)
+    {
+      bm_abort("bfree", "write after free", evicted);
+    }
+  }
+  block->canary ^= BM_FREED_MARK;
+  return evicted;
+}
+
+size_t guard_size()
+{
+  if (bm_guard < 0)
+  {
+    bm_guard = getenv("BMALLOC_GUARD") != NULL;
+  }
+  return bm_guard ? sysconf(_SC_PAGESIZE) : 0;
+}
+#endif
+
 int fitting(size_t s)
 {
 
@@ -41,6 +161,12 @@ int fitting(size_t s)
   return block_size;
 }
 
+// Allocates from the lowest-addressed region that has a fitting block, taking
+// the smallest such block there. Packing allocations into the same few
+// regions leaves the others free to coalesce back into whole regions that
+// bfree() can unmap. Built with -DBM_BEST_FIT_ANYWHERE it takes the smallest
+// fitting block of any region instead, the placement this replaced, so that
+// test6 can compare the two.
 void *find_best_fit(size_t s)
 {
   bm_header_ptr best_block = NULL;
@@ -49,7 +175,12 @@ void *find_best_fit(size_t s)
   {
     if (block->used == 0 && (1 << block->size) >= s)
     {
-      if (best_block == NULL || (1 << block->size) < (1 << best_block->size))
+#ifdef BM_BEST_FIT_ANYWHERE
+      if (best_block == NULL || block->size < best_block->size)
+#else
+      if (best_block == NULL || region_of(block) < region_of(best_block) ||
+          (region_of(block) == region_of(best_block) && block->size < best_block->size))
+#endif
       {
         best_block = block;
       }
@@ -80,7 +211,7 @@ void *split(bm_header_ptr block, size_t target_size)
     block->size--;
 
     // Check if buddy block will fit within the allocated memory
-    if ((void *)block + (1 << block->size) >= (void *)head + INIT_BLOCK_SIZE)
+    if ((void *)block + (1 << block->size) >= (void *)region_of(block) + INIT_BLOCK_SIZE)
     {
       block->size++;
       break;
@@ -90,67 +221,68 @@ void *split(bm_header_ptr block, size_t target_size)
     buddy->used = 0;
     buddy->size = block->size;
     buddy->next = block->next;
+    SET_CANARY(buddy);
     block->next = buddy;
-
-    if (head == block)
-    { // Update head pointer if block is the first block
-      head = buddy;
-    }
   }
   block->used = 1;
 
   return (void *)((bm_header_ptr)block + 1);
 }
 
-void *sibling(void *h)
+bm_header_ptr new_region()
 {
+  int flag = PROT_READ | PROT_WRITE;
+  int map_flag = MAP_ANONYMOUS | MAP_PRIVATE;
 
-  size_t block_size = ((bm_header_ptr)h)->size;
-  bm_header_ptr prev;
-  bm_header_ptr i;
-
-  if (block_size == 0 || block_size >= exponent(INIT_BLOCK_SIZE))
+#ifdef BM_HARDENED
+  bm_header_ptr block = mmap(NULL, INIT_BLOCK_SIZE + guard_size(), flag, map_flag, -1, 0);
+  if (block == MAP_FAILED)
+  {
     return NULL;
-
-  if (bm_list_head.next == (bm_header_ptr)h)
+  }
+  if (guard_size() > 0)
   {
-    if (block_size == ((bm_header_ptr)h)->next->size)
-    {
-      return ((bm_header_ptr)h)->next;
-    }
-    else
-      return NULL;
+    mprotect((void *)block + INIT_BLOCK_SIZE, guard_size(), PROT_NONE);
   }
-
-  int sum = 1;
-  for (i = bm_list_head.next, prev = NULL; i != NULL; prev = i, i = i->next)
+#else
+  bm_header_ptr block = mmap(NULL, INIT_BLOCK_SIZE, flag, map_flag, -1, 0);
+  if (block == MAP_FAILED)
   {
-    sum += (1 << i->size);
+    return NULL;
+  }
+#endif
+  block->used = 0;
+  block->size = exponent(INIT_BLOCK_SIZE);
+  block->next = NULL;
+  SET_CANARY(block);
 
-    if (i == (bm_header_ptr)h)
-    {
-      int idx = sum / (1 << i->size);
+  bm_header_ptr current = &bm_list_head;
+  while (current->next != NULL)
+  {
+    current = current->next;
+  }
+  current->next = block;
 
-      if (idx % 2 == 0)
-      {
-        if (prev->size == i->size && prev != NULL)
-        {
-          return (void *)prev; // give right
-        }
+  return block;
+}
 
-        break;
-      }
-      else
-      {
-        if (i->next->size == i->size && i->next != NULL)
-        {
-          return (void *)i->next; // give left
-        }
-        break;
-      }
-    }
+// Unlinks a region that has coalesced back into one free block and returns
+// its memory to the system.
+void release_region(bm_header_ptr prev, bm_header_ptr block)
+{
+  if (prev == NULL)
+  {
+    bm_list_head.next = block->next;
   }
-  return NULL;
+  else
+  {
+    prev->next = block->next;
+  }
+#ifdef BM_HARDENED
+  munmap(block, INIT_BLOCK_SIZE + guard_size());
+#else
+  munmap(block, INIT_BLOCK_SIZE);
+#endif
 }
 
 void *bmalloc(size_t s)
@@ -176,34 +308,11 @@ void *bmalloc(size_t s)
 
   if (best_block == NULL)
   {
-    int flag = PROT_READ | PROT_WRITE;
-    int map_flag = MAP_ANONYMOUS | MAP_PRIVATE;
-
-    bm_header_ptr block = mmap(NULL, INIT_BLOCK_SIZE, flag, map_flag, -1, 0);
-    if (block == MAP_FAILED)
+    best_block = new_region();
+    if (best_block == NULL)
     {
       return NULL;
     }
-    block->used = 0;
-    block->size = exponent(INIT_BLOCK_SIZE);
-    block->next = NULL;
-
-    if (head == NULL)
-    {
-      head = block;
-      bm_list_head.next = block;
-    }
-    else
-    {
-      bm_header_ptr current = &bm_list_head;
-      while (current->next != NULL)
-      {
-        current = current->next;
-      }
-      current->next = block;
-    }
-
-    best_block = block;
   }
 
   bm_header_ptr new_block = split(best_block, 1 << block_size);
@@ -225,6 +334,15 @@ void bfree(void *p)
     return;
   }
 
+#ifdef BM_HARDENED
+  bm_check(p, "bfree");
+  p = quarantine(p);
+  if (p == NULL)
+  {
+    return;
+  }
+#endif
+
   bm_header_ptr block = (bm_header_ptr)((char *)p - sizeof(bm_header));
   int found = 0;
 
@@ -255,8 +373,9 @@ void bfree(void *p)
   // Coalesce blocks if possible
   while (block->size != exponent(INIT_BLOCK_SIZE))
   {
-    bm_header_ptr buddy = sibling(block);
-    if (buddy == NULL || buddy->used == 1 || buddy->size != block->size)
+    // A whole buddy of the same order is always a list neighbour
+    bm_header_ptr buddy = buddy_of(block);
+    if ((buddy != block->next && buddy != prev) || buddy->used == 1 || buddy->size != block->size)
     {
       break;
     }
@@ -269,29 +388,183 @@ void bfree(void *p)
     }
 
     // Remove buddy from the linked list
-    if (prev == NULL)
+    block->next = buddy->next;
+    for (prev = NULL, current = bm_list_head.next; current != block; prev = current, current = current->next)
+      ;
+
+    // Coalesce block and buddy
+    block->size++;
+  }
+
+  // The whole region is free again: hand it back
+  if (block->size == exponent(INIT_BLOCK_SIZE))
+  {
+    release_region(prev, block);
+  }
+}
+
+// Hands out blocks of the given order from the front of a free block in a
+// single recursive split; whatever is not needed stays behind as free buddies.
+void carve(bm_header_ptr block, int order, size_t *left, void ***out)
+{
+  if (*left == 0)
+  {
+    return;
+  }
+
+  if (block->size == order)
+  {
+    block->used = 1;
+    *(*out)++ = (void *)(block + 1);
+    (*left)--;
+    return;
+  }
+
+  block->size--;
+  bm_header_ptr buddy = (bm_header_ptr)((void *)block + (1 << block->size));
+  buddy->used = 0;
+  buddy->size = block->size;
+  buddy->next = block->next;
+  SET_CANARY(buddy);
+  block->next = buddy;
+
+  carve(block, order, left, out);
+  carve(buddy, order, left, out);
+}
+
+size_t bmalloc_bulk(size_t s, size_t n, void **out)
+{
+  if (s < 1 || s > (INIT_BLOCK_SIZE - sizeof(bm_header) - 1))
+  {
+    printf("Error: The block size needs to be above 0 and below %zu.\n", (INIT_BLOCK_SIZE - sizeof(bm_header)));
+    return 0;
+  }
+
+  int block_size = fitting(s);
+  size_t left = n;
+  void **next_out = out;
+
+  while (left > 0)
+  {
+    bm_header_ptr block;
+    if (bm_mode == BestFit)
     {
-      bm_list_head.next = buddy->next;
+      block = find_best_fit(1 << block_size);
     }
     else
     {
-      prev->next = buddy->next;
+      block = find_first_fit(1 << block_size);
     }
 
-    // Coalesce block and buddy
-    block->size++;
+    if (block == NULL)
+    {
+      block = new_region();
+      if (block == NULL)
+      {
+        break;
+      }
+    }
+
+    carve(block, block_size, &left, &next_out);
+  }
+
+  return n - left;
+}
+
+int ptr_compare(const void *a, const void *b)
+{
+  uintptr_t x = (uintptr_t) * (void *const *)a;
+  uintptr_t y = (uintptr_t) * (void *const *)b;
+  return (x > y) - (x < y);
+}
 
-    // Check if the block size has reached the maximum size and munmap
-    if (block->size == exponent(INIT_BLOCK_SIZE))
+void bfree_bulk(void **ptrs, size_t n)
+{
+  if (ptrs == NULL || n == 0)
+  {
+    return;
+  }
+
+#ifdef BM_HARDENED
+  // The batch goes through the quarantine too; only evicted blocks are freed
+  size_t i, kept = 0;
+  for (i = 0; i < n; i++)
+  {
+    if (ptrs[i] == NULL)
     {
-      // If the block is the only one left and is not in use, unmap it
-      if (bm_list_head.next == NULL && block->used == 0)
+      continue;
+    }
+    bm_check(ptrs[i], "bfree_bulk");
+    void *evicted = quarantine(ptrs[i]);
+    if (evicted != NULL)
+    {
+      ptrs[kept++] = evicted;
+    }
+  }
+  n = kept;
+  if (n == 0)
+  {
+    return;
+  }
+#endif
+
+  // One walk over the list marks every block of the batch free; ptrs is
+  // sorted in place so each block is looked up by binary search.
+  qsort(ptrs, n, sizeof(void *), ptr_compare);
+
+  size_t released = 0;
+  bm_header_ptr block;
+  for (block = bm_list_head.next; block != NULL; block = block->next)
+  {
+    void *p = (void *)(block + 1);
+    if (block->used == 0 || bsearch(&p, ptrs, n, sizeof(void *), ptr_compare) == NULL)
+    {
+      continue;
+    }
+    block->used = 0;
+    memset(p, 0, (1 << block->size) - sizeof(bm_header));
+    released++;
+  }
+
+  for (; released < n; released++)
+  {
+    printf("Error: The requested memory is not found in the linked list.\n");
+  }
+
+  // Coalesce level by level: each pass merges every free left buddy with its
+  // free right buddy, so the loop runs at most once per order.
+  int merged = 1;
+  while (merged)
+  {
+    merged = 0;
+    for (block = bm_list_head.next; block != NULL; block = block->next)
+    {
+      while (block->used == 0 && block->size < exponent(INIT_BLOCK_SIZE) &&
+             block->next != NULL && block->next == buddy_of(block) &&
+             block->next->used == 0 && block->next->size == block->size)
       {
-        munmap(block, INIT_BLOCK_SIZE);
+        block->next = block->next->next;
+        block->size++;
+        merged = 1;
       }
-      break;
     }
   }
+
+  bm_header_ptr prev = NULL;
+  block = bm_list_head.next;
+  while (block != NULL)
+  {
+    bm_header_ptr next = block->next;
+    if (block->used == 0 && block->size == exponent(INIT_BLOCK_SIZE))
+    {
+      release_region(prev, block);
+    }
+    else
+    {
+      prev = block;
+    }
+    block = next;
+  }
 }
 
 void *brealloc(void *p, size_t s)
@@ -307,6 +580,10 @@ void *brealloc(void *p, size_t s)
     return NULL;
   }
 
+#ifdef BM_HARDENED
+  bm_check(p, "brealloc");
+#endif
+
   bm_header_ptr block = (bm_header_ptr)p - 1;
   size_t block_size = 1 << block->size;
   size_t min_required_size = s + sizeof(bm_header);
@@ -316,9 +593,13 @@ void *brealloc(void *p, size_t s)
     // If the current block can be split to fit the new size
     if (block_size >= (min_required_size << 1) + sizeof(bm_header))
     {
-      bfree(p);
       void *new_ptr = bmalloc(s);
+      if (new_ptr == NULL)
+      {
+        return p;
+      }
       memcpy(new_ptr, p, s);
+      bfree(p);
       return new_ptr;
     }
     return p;
@@ -341,6 +622,43 @@ void bmconfig(bm_option opt)
   bm_mode = opt;
 }
 
+int bmoccupancy(size_t *hist, int buckets)
+{
+  int regions = 0;
+  int i;
+  for (i = 0; i < buckets; i++)
+  {
+    hist[i] = 0;
+  }
+
+  bm_header_ptr block = bm_list_head.next;
+  while (block != NULL)
+  {
+    bm_header_ptr region = region_of(block);
+    size_t used = 0;
+    for (; block != NULL && region_of(block) == region; block = block->next)
+    {
+      if (block->used)
+      {
+        used += 1 << block->size;
+      }
+    }
+
+    // Completely used regions go to the last bucket
+    int bucket = used * buckets / INIT_BLOCK_SIZE;
+    if (bucket >= buckets)
+    {
+      bucket = buckets - 1;
+    }
+    if (buckets > 0)
+    {
+      hist[bucket]++;
+    }
+    regions++;
+  }
+  return regions;
+}
+
 void bmprint()
 {
   bm_header_ptr itr;
@@ -7,6 +7,9 @@ typedef enum {
 struct __attribute__ ((__packed__)) _bm_header {
 	unsigned int used : 1 ;
 	unsigned int size : 4 ;
+#ifdef BM_HARDENED
+	unsigned int canary ;
+#endif
 	struct _bm_header * next ;
 } ;
 
@@ -20,6 +23,12 @@ void bfree (void * p) ;
 
 void * brealloc (void * p, size_t s) ;
 
+size_t bmalloc_bulk (size_t s, size_t n, void ** out) ;
+
+void bfree_bulk (void ** ptrs, size_t n) ;
+
 void bmconfig (bm_option opt) ;
 
+int bmoccupancy (size_t * hist, int buckets) ;
+
 void bmprint () ;
\ No newline at end of file
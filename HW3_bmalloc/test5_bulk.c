@@ -0,0 +1,97 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "bmalloc.h"
+
+#define NODES 2048
+
+typedef 
+struct node {
+		int num ;
+		struct node * next ;
+} 
+Node ;
+
+void * ptrs[NODES] ;
+void * order[NODES] ;
+
+double
+elapsed(struct timespec * from)
+{
+	struct timespec now ;
+	clock_gettime(CLOCK_MONOTONIC, &now) ;
+	return (now.tv_sec - from->tv_sec) * 1e3 + (now.tv_nsec - from->tv_nsec) / 1e6 ;
+}
+
+int
+fill(int n)
+{
+	int i ;
+	for (i = 0 ; i < n ; i++) {
+		if (ptrs[i] == 0x0)
+			return 0 ;
+		((Node *) ptrs[i])->num = i ;
+	}
+	for (i = 0 ; i < n ; i++) {
+		if (((Node *) ptrs[i])->num != i)
+			return 0 ;
+	}
+	return 1 ;
+}
+
+void
+shuffle(int n)
+{
+	int i ;
+	srand(1) ;
+	for (i = 0 ; i < n ; i++)
+		order[i] = ptrs[i] ;
+	for (i = n - 1 ; i > 0 ; i--) {
+		int j = rand() % (i + 1) ;
+		void * t = order[i] ;
+		order[i] = order[j] ;
+		order[j] = t ;
+	}
+}
+
+int 
+main ()
+{
+	struct timespec t ;
+	double single_alloc, single_free, bulk_alloc, bulk_free ;
+	int i ;
+
+	clock_gettime(CLOCK_MONOTONIC, &t) ;
+	for (i = 0 ; i < NODES ; i++)
+		ptrs[i] = bmalloc(sizeof(Node)) ;
+	single_alloc = elapsed(&t) ;
+	if (!fill(NODES))
+		printf("bmalloc: broken nodes\n") ;
+
+	shuffle(NODES) ;
+	clock_gettime(CLOCK_MONOTONIC, &t) ;
+	for (i = 0 ; i < NODES ; i++)
+		bfree(order[i]) ;
+	single_free = elapsed(&t) ;
+
+	memset(ptrs, 0, sizeof(ptrs)) ;
+
+	clock_gettime(CLOCK_MONOTONIC, &t) ;
+	if (bmalloc_bulk(sizeof(Node), NODES, ptrs) != NODES)
+		printf("bmalloc_bulk: short allocation\n") ;
+	bulk_alloc = elapsed(&t) ;
+	if (!fill(NODES))
+		printf("bmalloc_bulk: broken nodes\n") ;
+
+	shuffle(NODES) ;
+	clock_gettime(CLOCK_MONOTONIC, &t) ;
+	bfree_bulk(order, NODES) ;
+	bulk_free = elapsed(&t) ;
+
+	printf("%d x bmalloc(%zu):   %10.3f ms\n", NODES, sizeof(Node), single_alloc) ;
+	printf("bmalloc_bulk(%zu, %d): %8.3f ms\n", sizeof(Node), NODES, bulk_alloc) ;
+	printf("%d x bfree:         %10.3f ms\n", NODES, single_free) ;
+	printf("bfree_bulk(%d):       %8.3f ms\n", NODES, bulk_free) ;
+	bmprint() ;
+}
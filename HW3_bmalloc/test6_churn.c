@@ -0,0 +1,105 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "bmalloc.h"
+
+#define OBJECTS 4096
+#define ROUNDS 20
+#define BUCKETS 4
+
+void * objs[OBJECTS] ;
+
+size_t
+rss_kb()
+{
+	long pages = 0, resident = 0 ;
+	FILE * fp = fopen("/proc/self/statm", "r") ;
+	if (fp == 0x0)
+		return 0 ;
+	if (fscanf(fp, "%ld %ld", &pages, &resident) != 2)
+		resident = 0 ;
+	fclose(fp) ;
+	return resident * sysconf(_SC_PAGESIZE) / 1024 ;
+}
+
+size_t
+random_size()
+{
+	/* mostly small nodes with the odd larger buffer */
+	if (rand() % 8 == 0)
+		return 200 + rand() % 1800 ;
+	return 8 + rand() % 120 ;
+}
+
+void
+report(char * phase)
+{
+	size_t hist[BUCKETS] ;
+	int regions = bmoccupancy(hist, BUCKETS) ;
+	printf("  %-6s rss %6zu KB  regions %5d  occupancy", phase, rss_kb(), regions) ;
+	for (int i = 0 ; i < BUCKETS ; i++)
+		printf(" %5zu", hist[i]) ;
+	printf("\n") ;
+}
+
+void
+churn(bm_option opt)
+{
+	int i, r ;
+
+	srand(7) ;
+	bmconfig(opt) ;
+#ifdef BM_BEST_FIT_ANYWHERE
+	printf("%s\n", opt == BestFit ? "BestFit, smallest block anywhere" : "FirstFit") ;
+#else
+	printf("%s\n", opt == BestFit ? "BestFit, lowest region" : "FirstFit") ;
+#endif
+
+	for (i = 0 ; i < OBJECTS ; i++)
+		objs[i] = bmalloc(random_size()) ;
+	report("fill") ;
+
+	for (r = 0 ; r < ROUNDS ; r++) {
+		for (i = 0 ; i < OBJECTS ; i++) {
+			if (rand() % 2 == 0) {
+				bfree(objs[i]) ;
+				objs[i] = bmalloc(random_size()) ;
+			}
+		}
+	}
+	report("churn") ;
+
+	/* keep one object in ten alive, as a long-running process would */
+	for (i = 0 ; i < OBJECTS ; i++) {
+		if (i % 10 != 0) {
+			bfree(objs[i]) ;
+			objs[i] = 0x0 ;
+		}
+	}
+	report("drain") ;
+}
+
+int 
+main ()
+{
+	/* built with -DBM_BEST_FIT_ANYWHERE only BestFit differs, so only it runs */
+#ifdef BM_BEST_FIT_ANYWHERE
+	bm_option opts[] = { BestFit } ;
+#else
+	bm_option opts[] = { FirstFit, BestFit } ;
+#endif
+	int nopts = sizeof(opts) / sizeof(opts[0]) ;
+
+	printf("occupancy buckets: <25%% <50%% <75%% <=100%%\n") ;
+	fflush(stdout) ;
+	for (int i = 0 ; i < nopts ; i++) {
+		/* each policy starts from an empty heap */
+		if (fork() == 0) {
+			churn(opts[i]) ;
+			exit(0) ;
+		}
+		wait(0x0) ;
+	}
+	return 0 ;
+}